@@ -0,0 +1,77 @@
+#include "alloccount.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifndef NO_ALLOCATION_COUNTING
+
+//per thread, so the metrics exporter thread doesn't show up in the render thread's frames
+static thread_local uint64_t allocations = 0;
+
+//the rest of the standard library's operator new & delete (arrays, nothrow) end up in these
+void* operator new(std::size_t size)
+{
+	allocations++;
+	//malloc(0) may give back null, new never does
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	allocations++;
+	size_t align = (size_t)alignment;
+	//aligned_alloc wants a whole number of alignments
+	void* memory = std::aligned_alloc(align, (size + align - 1) / align * align);
+	if (!memory) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+	std::free(memory);
+}
+
+uint64_t threadAllocations()
+{
+	return allocations;
+}
+
+bool allocationCountingCompiled()
+{
+	return true;
+}
+
+#else
+
+uint64_t threadAllocations()
+{
+	return 0;
+}
+
+bool allocationCountingCompiled()
+{
+	return false;
+}
+
+#endif
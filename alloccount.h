@@ -0,0 +1,14 @@
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+#include <cstdint>
+
+//heap allocations (operator new, plain & aligned, arrays included) the calling thread made so far, counted by the
+//replacement operator new in alloccount.cpp, so a frame's allocations are the difference across it
+//malloc from c code (sdl, the gl driver, libpng) isn't counted, only what c++ code news
+//build with -DNO_ALLOCATION_COUNTING and operator new is the standard library's again, this then stays at zero
+uint64_t threadAllocations();
+//false when built with NO_ALLOCATION_COUNTING
+bool allocationCountingCompiled();
+
+#endif // !ALLOCCOUNT_H
@@ -0,0 +1,53 @@
+#include "arena.h"
+
+#include <algorithm>
+
+FrameArena::FrameArena(size_t capacity) : block(new unsigned char[capacity]), blockSize(capacity)
+{
+}
+
+//the offset in a block of base at which bytes with that alignment start
+static size_t alignedOffset(const unsigned char* base, size_t offset, size_t alignment)
+{
+	uintptr_t address = (uintptr_t)(base + offset);
+	return offset + ((alignment - address % alignment) % alignment);
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	size_t start = alignedOffset(block.get(), offset, alignment);
+	if (extra.empty() && start + bytes <= blockSize) {
+		usedBytes += start + bytes - offset;
+		offset = start + bytes;
+		return block.get() + start;
+	}
+	//over the block: this frame carries on in extra blocks, one at least as big as the main one at a time
+	if (!extra.empty()) {
+		start = alignedOffset(extra.back().get(), extraOffset, alignment);
+	}
+	if (extra.empty() || start + bytes > extraSize) {
+		extraSize = std::max(blockSize, bytes + alignment);
+		extra.emplace_back(new unsigned char[extraSize]);
+		extraOffset = 0;
+		start = alignedOffset(extra.back().get(), 0, alignment);
+	}
+	usedBytes += start + bytes - extraOffset;
+	extraOffset = start + bytes;
+	return extra.back().get() + start;
+}
+
+void FrameArena::reset()
+{
+	peakBytes = std::max(peakBytes, usedBytes);
+	//next frame gets one block with room for all of this one
+	if (!extra.empty()) {
+		while (blockSize < usedBytes) {
+			blockSize *= 2;
+		}
+		extra.clear();
+		block.reset(new unsigned char[blockSize]);
+		overflowCount++;
+	}
+	offset = 0;
+	usedBytes = 0;
+}
@@ -0,0 +1,77 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+//memory for what only lives until the end of the frame (render graph passes, their callbacks & resource lists):
+//allocating bumps a pointer, freeing does nothing, and reset() takes it all back at once at the end of the frame
+//when a frame needs more than the block holds it gets extra blocks, and the next reset() replaces them with one
+//block big enough for all of it, so after the first few frames the arena stops asking the heap for anything
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t capacity = 64 * 1024);
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	//never null, alignment a power of two
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	template <typename T>
+	T* allocate(size_t count = 1)
+	{
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+	//everything handed out since the last reset is gone, nothing's destructor runs
+	void reset();
+
+	//bytes handed out this frame & the most any frame used
+	size_t used() const { return usedBytes; }
+	size_t peak() const { return peakBytes; }
+	size_t capacity() const { return blockSize; }
+	//frames that didn't fit in the block & had to grow it
+	int overflows() const { return overflowCount; }
+
+private:
+	std::unique_ptr<unsigned char[]> block;
+	size_t blockSize;
+	size_t offset = 0;
+	//this frame's blocks past the first, freed (and folded into it) by reset()
+	std::vector<std::unique_ptr<unsigned char[]>> extra;
+	size_t extraSize = 0;
+	size_t extraOffset = 0;
+	size_t usedBytes = 0;
+	size_t peakBytes = 0;
+	int overflowCount = 0;
+};
+
+//lets standard containers live in a FrameArena: std::vector<int, ArenaAllocator<int>> list(arena)
+//deallocate is a no-op, the memory comes back with the arena's reset (so the containers have to be gone by then)
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) { return arena->allocate<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+	template <typename U>
+	friend class ArenaAllocator;
+	FrameArena* arena;
+};
+
+#endif // !ARENA_H
@@ -0,0 +1,60 @@
+#include "assetload.h"
+#include "hash.h"
+#include "mipmap.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include <iostream>
+
+Task<uint64_t> decodeOnWorker(TaskScheduler& scheduler, std::string path, MipChain& chain)
+{
+	co_await scheduler.onWorker();
+	TaskStage stage(scheduler, "decode texture");
+	uint64_t hash = hashFile(path.c_str());
+	if (hash == 0 || !loadMipmappedChain(path.c_str(), chain)) {
+		std::cout << "Failed to load texture " << path << std::endl;
+		co_return 0;
+	}
+	co_return hash;
+}
+
+Task<TextureHandle> uploadOnGLThread(TaskScheduler& scheduler, TextureManager& textures, std::string path, uint64_t hash,
+	const MipChain& chain)
+{
+	co_await scheduler.onGLThread();
+	TaskStage stage(scheduler, "upload texture");
+	co_return textures.load(path, hash, chain);
+}
+
+Task<void> loadTextureAsset(TaskScheduler& scheduler, TextureManager& textures, std::string path, TextureHandle& handle)
+{
+	MipChain chain;
+	uint64_t hash = co_await decodeOnWorker(scheduler, path, chain);
+	if (hash != 0) {
+		handle = co_await uploadOnGLThread(scheduler, textures, path, hash, chain);
+	}
+}
+
+Task<void> loadShaderAsset(TaskScheduler& scheduler, std::string vertexPath, std::string fragmentPath, std::optional<Shader>& shader)
+{
+	std::string vertexCode = co_await readFile(scheduler, vertexPath);
+	std::string fragmentCode = co_await readFile(scheduler, fragmentPath);
+	co_await scheduler.onGLThread();
+	TaskStage stage(scheduler, "compile shader");
+	shader.emplace(Shader::fromSource(vertexCode, fragmentCode));
+}
+
+Task<void> loadWindowIcon(TaskScheduler& scheduler, SDL_Window* window, std::string path)
+{
+	co_await scheduler.onWorker();
+	SDL_Surface* icon;
+	{
+		TaskStage stage(scheduler, "decode icon");
+		icon = IMG_Load(path.c_str());
+	}
+	co_await scheduler.onGLThread();
+	TaskStage stage(scheduler, "set icon");
+	SDL_SetWindowIcon(window, icon);
+	SDL_FreeSurface(icon);
+}
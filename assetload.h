@@ -0,0 +1,31 @@
+#ifndef ASSETLOAD_H
+#define ASSETLOAD_H
+
+#include "shader.h"
+#include "tasks.h"
+#include "texman.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+struct MipChain;
+struct SDL_Window;
+
+//the steps startup loads its assets in, as tasks for a TaskScheduler: disk & cpu work on a worker,
+//gl calls on the gl thread, each step timed as a TaskStage
+
+//the asset's mip chain (from its cache, or decoded & generated) and its content hash, 0 if it can't be read
+Task<uint64_t> decodeOnWorker(TaskScheduler& scheduler, std::string path, MipChain& chain);
+//hands the chain to the manager, which uploads it (or shares the texture that has the same hash)
+Task<TextureHandle> uploadOnGLThread(TaskScheduler& scheduler, TextureManager& textures, std::string path, uint64_t hash,
+	const MipChain& chain);
+
+//the two above, handle stays invalid if the texture can't be loaded
+Task<void> loadTextureAsset(TaskScheduler& scheduler, TextureManager& textures, std::string path, TextureHandle& handle);
+//reads both sources on a worker and compiles them on the gl thread
+Task<void> loadShaderAsset(TaskScheduler& scheduler, std::string vertexPath, std::string fragmentPath, std::optional<Shader>& shader);
+//decodes the image on a worker, the window only gets touched on the gl thread
+Task<void> loadWindowIcon(TaskScheduler& scheduler, SDL_Window* window, std::string path);
+
+#endif // !ASSETLOAD_H
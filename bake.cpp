@@ -0,0 +1,146 @@
+#include "bake.h"
+#include "hash.h"
+#include "mipmap.h"
+#include "shader.h"
+#include "texture.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+//bump when the bake pass changes so old results are not reused
+static const uint64_t bakeVersion = 1;
+
+bool canBakeBlend(const BlendMaterial& material)
+{
+	return material.weightIsConstant && material.inputs[0].isStatic && material.inputs[1].isStatic
+		&& material.inputs[0].texture != 0 && material.inputs[1].texture != 0;
+}
+
+static void textureSize(unsigned int texture, int& width, int& height)
+{
+	int previous;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+	glBindTexture(GL_TEXTURE_2D, previous);
+}
+
+//draws the blend into an offscreen target and reads level 0 back into the chain
+static bool renderBlend(const BlendMaterial& material, const SamplerLibrary& samplers,
+	const std::filesystem::path& shaderDir, MipChain& chain)
+{
+	int width = chain.levels[0].width;
+	int height = chain.levels[0].height;
+	//flush anything older so the check after the read only sees errors from the bake
+	while (glGetError() != GL_NO_ERROR) {
+	}
+
+	//the bake can run in the middle of setting up the scene, so whatever it rebinds is put back
+	int previousFramebuffer, previousVertexArray, previousProgram;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	unsigned int target, framebuffer, vertexArray;
+	glGenTextures(1, &target);
+	glBindTexture(GL_TEXTURE_2D, target);
+	allocateTextureStorage(GL_RGBA8, 1, width, height);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+	bool success = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	if (success) {
+		int viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		glDisable(GL_DEPTH_TEST);
+		glViewport(0, 0, width, height);
+
+		Shader bakeShader((shaderDir / "bake.vs").c_str(), (shaderDir / "bake.fs").c_str());
+		bakeShader.use();
+		bakeShader.setInt("texture1", 0);
+		bakeShader.setInt("texture2", 1);
+		bakeShader.setFloat("blendWeight", material.weight);
+		for (int i = 0; i < 2; i++) {
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, material.inputs[i].texture);
+			samplers.bind(i, "trilinear_clamp");
+		}
+		//the triangle comes from gl_VertexID, the vertex array is only there to be bound
+		glGenVertexArrays(1, &vertexArray);
+		glBindVertexArray(vertexArray);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, chain.level(0));
+		success = glGetError() == GL_NO_ERROR;
+
+		glBindVertexArray(previousVertexArray);
+		glDeleteVertexArrays(1, &vertexArray);
+		for (int i = 1; i >= 0; i--) {
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glBindSampler(i, 0);
+		}
+		glUseProgram(previousProgram);
+		glDeleteProgram(bakeShader.ID);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		if (depthTest) {
+			glEnable(GL_DEPTH_TEST);
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &target);
+	return success;
+}
+
+unsigned int bakeBlend(const BlendMaterial& material, const SamplerLibrary& samplers,
+	const std::filesystem::path& shaderDir, const std::filesystem::path& cacheDir)
+{
+	if (!canBakeBlend(material)) {
+		return 0;
+	}
+	//the bigger input decides the resolution so neither loses detail
+	int width0, height0, width1, height1;
+	textureSize(material.inputs[0].texture, width0, height0);
+	textureSize(material.inputs[1].texture, width1, height1);
+	int width = std::max(width0, width1);
+	int height = std::max(height0, height1);
+
+	MipStamp stamp;
+	stamp.source = hashCombine(hashFile(material.inputs[0].path.c_str()), hashFile(material.inputs[1].path.c_str()));
+	uint32_t weightBits;
+	memcpy(&weightBits, &material.weight, sizeof(weightBits));
+	stamp.params = hashCombine(hashCombine(hashCombine(hashSeed, bakeVersion), weightBits), ((uint64_t)width << 32) | height);
+	std::filesystem::path cachePath = cacheDir / (hashToString(hashCombine(stamp.source, stamp.params)) + ".mips");
+
+	unsigned int baked;
+	glGenTextures(1, &baked);
+	glBindTexture(GL_TEXTURE_2D, baked);
+	if (uploadMipFile(cachePath.string(), stamp)) {
+		return baked;
+	}
+
+	MipChain chain;
+	chain.allocate(width, height);
+	if (!renderBlend(material, samplers, shaderDir, chain)) {
+		std::cout << "ERROR::BAKE::RENDER_FAILED" << std::endl;
+		glDeleteTextures(1, &baked);
+		return 0;
+	}
+	generateMipChain(chain);
+	std::error_code error;
+	std::filesystem::create_directories(cacheDir, error);
+	if (error || !saveMipFile(cachePath.string(), stamp, chain)) {
+		std::cout << "Failed to write baked texture " << cachePath << std::endl;
+	}
+	glBindTexture(GL_TEXTURE_2D, baked);
+	uploadMipChain(chain);
+	return baked;
+}
@@ -0,0 +1,35 @@
+#ifndef BAKE_H
+#define BAKE_H
+
+#include "sampler.h"
+
+#include <filesystem>
+#include <string>
+
+//one texture feeding a material
+struct MaterialInput
+{
+	std::string path;
+	unsigned int texture;
+	//never changes after loading (no streaming, render targets or animation)
+	bool isStatic;
+};
+
+//two inputs combined the way shader.fs does it: mix(inputs[0], inputs[1], weight)
+struct BlendMaterial
+{
+	MaterialInput inputs[2];
+	float weight;
+	//the weight is not driven by anything at runtime
+	bool weightIsConstant;
+};
+
+//a blend can be baked when nothing about it can change after load
+bool canBakeBlend(const BlendMaterial& material);
+
+//renders the blend once into a new mipmapped texture with an fbo pass, returns 0 if it failed
+//results are cached in cacheDir keyed by the input file hashes and the blend parameters
+unsigned int bakeBlend(const BlendMaterial& material, const SamplerLibrary& samplers,
+	const std::filesystem::path& shaderDir, const std::filesystem::path& cacheDir);
+
+#endif // !BAKE_H
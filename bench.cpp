@@ -0,0 +1,249 @@
+#include "bench.h"
+
+#include <glad/glad.h>
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool BenchScript::load(const char* path)
+{
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "ERROR::BENCH::SCRIPT_NOT_FOUND " << path << std::endl;
+		return false;
+	}
+	//the file name unless the script names itself
+	name = std::filesystem::path(path).stem().string();
+	keys.clear();
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string word;
+		if (!(words >> word)) {
+			continue;
+		}
+		bool ok = true;
+		if (word == "name") {
+			ok = (bool)(words >> name);
+		}
+		else if (word == "cubes") {
+			ok = (bool)(words >> cubes) && cubes > 0;
+		}
+		else if (word == "warmup") {
+			ok = (bool)(words >> warmupFrames) && warmupFrames >= 0;
+		}
+		else if (word == "frames") {
+			ok = (bool)(words >> frames) && frames > 0;
+		}
+		else if (word == "step") {
+			ok = (bool)(words >> timeStep) && timeStep > 0.0f;
+		}
+		else if (word == "key") {
+			CameraKey key;
+			ok = (bool)(words >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch >> key.fov);
+			//keys have to come in time order for camera() to find them
+			ok = ok && (keys.empty() || key.time > keys.back().time);
+			if (ok) {
+				keys.push_back(key);
+			}
+		}
+		else {
+			ok = false;
+		}
+		if (!ok) {
+			std::cout << "ERROR::BENCH::SCRIPT_SYNTAX " << path << ":" << lineNumber << ": " << line << std::endl;
+			return false;
+		}
+	}
+	if (keys.empty()) {
+		std::cout << "ERROR::BENCH::SCRIPT_HAS_NO_CAMERA_KEYS " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+CameraKey BenchScript::camera(float time) const
+{
+	if (time <= keys.front().time) {
+		return keys.front();
+	}
+	for (size_t i = 1; i < keys.size(); i++) {
+		if (time < keys[i].time) {
+			const CameraKey& a = keys[i - 1];
+			const CameraKey& b = keys[i];
+			float t = (time - a.time) / (b.time - a.time);
+			CameraKey key;
+			key.time = time;
+			key.position = a.position + (b.position - a.position) * t;
+			key.yaw = a.yaw + (b.yaw - a.yaw) * t;
+			key.pitch = a.pitch + (b.pitch - a.pitch) * t;
+			key.fov = a.fov + (b.fov - a.fov) * t;
+			return key;
+		}
+	}
+	return keys.back();
+}
+
+//nearest rank, so every reported value is a frame that actually happened
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+	return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+BenchStats summarizeFrameTimes(std::vector<double> samples)
+{
+	BenchStats stats;
+	if (samples.empty()) {
+		return stats;
+	}
+	std::sort(samples.begin(), samples.end());
+	double total = 0.0;
+	for (double sample : samples) {
+		total += sample;
+	}
+	stats.mean = total / samples.size();
+	stats.p50 = percentile(samples, 50.0);
+	stats.p95 = percentile(samples, 95.0);
+	stats.p99 = percentile(samples, 99.0);
+	stats.max = samples.back();
+	return stats;
+}
+
+BenchRecorder::BenchRecorder(const BenchScript& script) : script(script)
+{
+	cpuTimes.reserve(script.frames);
+	inputLatencies.reserve(script.frames);
+	queries.resize(script.frames);
+	glGenQueries(script.frames, queries.data());
+}
+
+BenchRecorder::~BenchRecorder()
+{
+	glDeleteQueries((GLsizei)queries.size(), queries.data());
+}
+
+void BenchRecorder::beginFrame()
+{
+	if (inFrame || done()) {
+		return;
+	}
+	started++;
+	inFrame = true;
+	frameStart = SDL_GetPerformanceCounter();
+	if (perf) {
+		perf->read(perfStart);
+	}
+	if (!warmingUp()) {
+		glBeginQuery(GL_TIME_ELAPSED, queries[started - 1 - script.warmupFrames]);
+	}
+}
+
+void BenchRecorder::endFrame()
+{
+	if (!inFrame) {
+		return;
+	}
+	inFrame = false;
+	if (warmingUp()) {
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	stats += lastFrameRenderStats();
+	PerfSample perfEnd;
+	if (perf && perf->read(perfEnd)) {
+		perfTotal += perfEnd - perfStart;
+	}
+	uint64_t now = SDL_GetPerformanceCounter();
+	cpuTimes.push_back((double)(now - frameStart) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+}
+
+void BenchRecorder::recordInputLatency(double milliseconds)
+{
+	if (inFrame && !warmingUp()) {
+		inputLatencies.push_back(milliseconds);
+	}
+}
+
+static void writeStats(std::ostream& out, const char* name, const BenchStats& stats)
+{
+	out << "\t\"" << name << "\": {\"mean\": " << stats.mean << ", \"p50\": " << stats.p50 << ", \"p95\": " << stats.p95
+		<< ", \"p99\": " << stats.p99 << ", \"max\": " << stats.max << "}";
+}
+
+bool BenchRecorder::finish(const char* path)
+{
+	endFrame();
+	//only frames that completed have a query worth reading
+	int measured = (int)cpuTimes.size();
+	std::vector<double> gpuTimes;
+	gpuTimes.reserve(measured);
+	for (int i = 0; i < measured; i++) {
+		GLuint64 elapsed = 0;
+		//blocks until the gpu got there, fine now that the run is over
+		glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+		gpuTimes.push_back(elapsed / 1000000.0);
+	}
+	BenchStats cpu = summarizeFrameTimes(cpuTimes);
+	BenchStats gpu = summarizeFrameTimes(gpuTimes);
+	double framesMeasured = std::max(measured, 1);
+
+	std::cout << "bench " << script.name << ": " << measured << " frames, cpu p50 " << cpu.p50 << " p95 " << cpu.p95
+		<< " p99 " << cpu.p99 << " ms, gpu p50 " << gpu.p50 << " ms" << std::endl;
+	if (renderStatsCompiled()) {
+		printRenderStats(std::cout, stats, measured);
+	}
+	if (perf) {
+		printPerfSample(std::cout, *perf, perfTotal, measured);
+	}
+
+	std::ofstream out(path);
+	if (!out) {
+		std::cout << "ERROR::BENCH::COULD_NOT_WRITE " << path << std::endl;
+		return false;
+	}
+	const char* renderer = (const char*)glGetString(GL_RENDERER);
+	out << "{\n";
+	out << "\t\"script\": \"" << script.name << "\",\n";
+	out << "\t\"renderer\": \"" << (renderer ? renderer : "unknown") << "\",\n";
+	out << "\t\"cubes\": " << script.cubes << ",\n";
+	out << "\t\"warmup_frames\": " << script.warmupFrames << ",\n";
+	out << "\t\"frames\": " << measured << ",\n";
+	writeStats(out, "cpu_ms", cpu);
+	out << ",\n";
+	writeStats(out, "gpu_ms", gpu);
+	out << ",\n";
+	writeStats(out, "input_to_submit_ms", summarizeFrameTimes(inputLatencies));
+	//per frame averages, left out when the counters were compiled out so they don't read as an empty scene
+	if (renderStatsCompiled()) {
+		out << ",\n";
+		out << "\t\"draw_calls\": " << stats.drawCalls / framesMeasured << ",\n";
+		out << "\t\"primitives\": " << stats.primitives / framesMeasured << ",\n";
+		out << "\t\"program_binds\": " << stats.programBinds / framesMeasured << ",\n";
+		out << "\t\"texture_binds\": " << stats.textureBinds / framesMeasured << ",\n";
+		out << "\t\"uniform_uploads\": " << stats.uniformUploads / framesMeasured << ",\n";
+		out << "\t\"buffer_bytes\": " << stats.bufferBytes / framesMeasured << ",\n";
+		out << "\t\"state_changes\": " << stats.stateChanges / framesMeasured;
+	}
+	//per frame means of whichever counters could be opened
+	if (perf) {
+		out << ",\n\t\"perf\": {";
+		bool first = true;
+		for (int i = 0; i < PerfCounterCount; i++) {
+			if (perf->available((PerfCounter)i)) {
+				out << (first ? "" : ", ") << "\"" << perfCounterNames[i] << "\": " << perfTotal.values[i] / framesMeasured;
+				first = false;
+			}
+		}
+		out << "}";
+	}
+	out << "\n}\n";
+	return (bool)out;
+}
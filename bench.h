@@ -0,0 +1,100 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "perfcounters.h"
+#include "renderstats.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//one point on a scripted camera path, the camera moves linearly between keys
+struct CameraKey
+{
+	float time;
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+	float fov;
+};
+
+//what a benchmark run renders, read from a text file like benchmarks/orbit.bench:
+//  name <name>
+//  cubes <number of cubes in the scene>
+//  warmup <frames rendered but not measured>
+//  frames <frames measured>
+//  step <simulated seconds per frame>
+//  key <time> <x> <y> <z> <yaw> <pitch> <fov>
+//anything after a # is a comment
+struct BenchScript
+{
+	std::string name;
+	int cubes = 10;
+	int warmupFrames = 60;
+	int frames = 600;
+	//the scene only ever sees frame * timeStep as its time, never the wall clock, so every run
+	//renders exactly the same frames
+	float timeStep = 1.0f / 60.0f;
+	std::vector<CameraKey> keys;
+
+	bool load(const char* path);
+	//the camera at a point in time, held at the first/last key outside the path
+	CameraKey camera(float time) const;
+};
+
+//a distribution of per frame times in milliseconds
+struct BenchStats
+{
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+BenchStats summarizeFrameTimes(std::vector<double> samples);
+
+//times every frame of a run with SDL_GetPerformanceCounter on the cpu and a GL_TIME_ELAPSED query on the gpu
+//the queries are only read back in finish() so measuring never stalls the pipeline
+class BenchRecorder
+{
+public:
+	explicit BenchRecorder(const BenchScript& script);
+	~BenchRecorder();
+	BenchRecorder(const BenchRecorder&) = delete;
+	BenchRecorder& operator=(const BenchRecorder&) = delete;
+
+	//frames are begun right after the previous one was presented and ended right after their own present
+	//(the render stats frame has to be closed before that)
+	void beginFrame();
+	void endFrame();
+	//the frame being rendered, counting the warm-up
+	int frame() const { return started - 1; }
+	bool warmingUp() const { return started <= script.warmupFrames; }
+	bool done() const { return started >= script.warmupFrames + script.frames && !inFrame; }
+	//adds the counters' per frame deltas to the results (they have to stay open until finish)
+	void setPerfCounters(const PerfCounters* counters) { perf = counters; }
+	//time from sampling input to submitting (presenting) the frame built from it, for the frame being ended next
+	void recordInputLatency(double milliseconds);
+
+	//waits for the outstanding queries, prints a summary and writes the results as json
+	bool finish(const char* path);
+
+private:
+	const BenchScript& script;
+	int started = 0;
+	bool inFrame = false;
+	uint64_t frameStart = 0;
+	std::vector<double> cpuTimes;
+	std::vector<double> inputLatencies;
+	std::vector<unsigned int> queries;
+	//what the measured frames asked of gl, from the render stats
+	RenderStats stats;
+	const PerfCounters* perf = nullptr;
+	PerfSample perfStart;
+	PerfSample perfTotal;
+};
+
+#endif // !BENCH_H
@@ -0,0 +1,134 @@
+//compares a benchmark result (main --bench) against a stored baseline and flags regressions
+//usage: benchcompare <baseline.json> <result.json> [threshold percent, default 5]
+//exits with 1 if any frame time got slower than the threshold allows
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+//reads the numbers out of the json main writes, nested keys are joined with dots (e.g. "cpu_ms.p95")
+//strings are skipped, this isn't a general json parser
+static bool readResults(const char* path, std::map<std::string, double>& values, std::map<std::string, std::string>& strings)
+{
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "ERROR::BENCHCOMPARE::FILE_NOT_FOUND " << path << std::endl;
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string text = buffer.str();
+
+	std::string prefix;
+	std::string key;
+	bool haveKey = false;
+	for (size_t i = 0; i < text.size(); i++) {
+		char c = text[i];
+		if (c == '"') {
+			size_t end = text.find('"', i + 1);
+			if (end == std::string::npos) {
+				break;
+			}
+			std::string word = text.substr(i + 1, end - i - 1);
+			if (haveKey) {
+				strings[prefix + key] = word;
+				haveKey = false;
+			}
+			else {
+				key = word;
+				haveKey = true;
+			}
+			i = end;
+		}
+		else if (c == '{') {
+			if (haveKey) {
+				prefix += key + ".";
+				haveKey = false;
+			}
+		}
+		else if (c == '}') {
+			size_t dot = prefix.empty() ? std::string::npos : prefix.rfind('.', prefix.size() - 2);
+			prefix = dot == std::string::npos ? "" : prefix.substr(0, dot + 1);
+		}
+		else if (haveKey && (c == '-' || isdigit((unsigned char)c))) {
+			char* end;
+			values[prefix + key] = strtod(text.c_str() + i, &end);
+			i = end - text.c_str() - 1;
+			haveKey = false;
+		}
+	}
+	if (values.empty()) {
+		std::cout << "ERROR::BENCHCOMPARE::NO_RESULTS_IN " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		std::cout << "usage: benchcompare <baseline.json> <result.json> [threshold percent]" << std::endl;
+		return 2;
+	}
+	double threshold = argc > 3 ? atof(argv[3]) : 5.0;
+
+	std::map<std::string, double> baseline, result;
+	std::map<std::string, std::string> baselineStrings, resultStrings;
+	if (!readResults(argv[1], baseline, baselineStrings) || !readResults(argv[2], result, resultStrings)) {
+		return 2;
+	}
+
+	//numbers from different scenes or gpus can't be compared, say so but still show them
+	const char* sameRun[] = {"script", "renderer"};
+	for (const char* key : sameRun) {
+		if (baselineStrings[key] != resultStrings[key]) {
+			std::cout << "warning: " << key << " differs (" << baselineStrings[key] << " vs " << resultStrings[key] << ")" << std::endl;
+		}
+	}
+	//the render stats are missing from builds with NO_RENDER_STATS, only compared when both have them
+	const char* sameScene[] = {"cubes", "draw_calls", "primitives", "program_binds", "texture_binds", "uniform_uploads",
+		"buffer_bytes", "state_changes"};
+	for (const char* key : sameScene) {
+		if (baseline.count(key) && result.count(key) && baseline[key] != result[key]) {
+			std::cout << "warning: " << key << " differs (" << baseline[key] << " vs " << result[key] << "), the scene changed" << std::endl;
+		}
+	}
+
+	//lower is better for everything compared
+	const char* timed[] = {"cpu_ms.p50", "cpu_ms.p95", "cpu_ms.p99", "gpu_ms.p50", "gpu_ms.p95", "gpu_ms.p99",
+		"input_to_submit_ms.p50", "input_to_submit_ms.p99"};
+	int regressions = 0;
+	for (const char* key : timed) {
+		if (!baseline.count(key) || !result.count(key)) {
+			std::cout << key << ": missing" << std::endl;
+			continue;
+		}
+		double before = baseline[key];
+		double after = result[key];
+		double change = before > 0.0 ? (after - before) / before * 100.0 : 0.0;
+		bool regressed = change > threshold;
+		regressions += regressed;
+		std::cout << key << ": " << before << " -> " << after << " ms (" << (change >= 0.0 ? "+" : "") << change << "%)"
+			<< (regressed ? "  REGRESSION" : change < -threshold ? "  improved" : "") << std::endl;
+	}
+	//the cpu counters (main --perf-counters) help explain a cpu_ms change, they're shown but never fail the run
+	for (const std::pair<const std::string, double>& value : baseline) {
+		if (value.first.compare(0, 5, "perf.") != 0 || !result.count(value.first)) {
+			continue;
+		}
+		double before = value.second;
+		double after = result[value.first];
+		double change = before > 0.0 ? (after - before) / before * 100.0 : 0.0;
+		std::cout << value.first << ": " << before << " -> " << after << " (" << (change >= 0.0 ? "+" : "") << change << "%)"
+			<< std::endl;
+	}
+	if (regressions) {
+		std::cout << regressions << " regression(s) over " << threshold << "%" << std::endl;
+		return 1;
+	}
+	return 0;
+}
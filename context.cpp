@@ -0,0 +1,310 @@
+#include "context.h"
+#include "cpuprofile.h"
+
+#include <SDL2/SDL.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+static void* eglLoad(const char* name)
+{
+	return (void*)eglGetProcAddress(name);
+}
+
+static bool hasEglExtension(const char* extensions, const char* name)
+{
+	size_t length = strlen(name);
+	for (const char* found = extensions ? strstr(extensions, name) : NULL; found; found = strstr(found + 1, name)) {
+		if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool RenderContext::createWindow(const char* title, int w, int h)
+{
+	width = w;
+	height = h;
+	window = SDL_CreateWindow(title, 0, 0, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+	if (window == NULL) {
+		std::cout << "Failed to create window: " << SDL_GetError() << std::endl;
+		return false;
+	}
+	windowContext = SDL_GL_CreateContext(window);
+	if (windowContext == NULL) {
+		std::cout << "Failed to create GL context: " << SDL_GetError() << std::endl;
+		return false;
+	}
+	loadProc = (GLADloadproc)SDL_GL_GetProcAddress;
+	if (!gladLoadGLLoader(loadProc)) {
+		std::cout << "Failed to initalize GLAD" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool RenderContext::createHeadless(int w, int h)
+{
+	width = w;
+	height = h;
+	//EGL_MESA_platform_surfaceless needs no display server at all, plain eglGetDisplay is the fallback
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	if (getPlatformDisplay && hasEglExtension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless")) {
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (eglDisplay == EGL_NO_DISPLAY) {
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+		std::cout << "Failed to initialize EGL: " << std::hex << eglGetError() << std::dec << std::endl;
+		return false;
+	}
+	display = eglDisplay;
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "EGL has no desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	//a pbuffer config if there is one, surfaceless displays may have none and make do without a config
+	const char* extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+	bool surfaceless = hasEglExtension(extensions, "EGL_KHR_surfaceless_context");
+	EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = NULL;
+	EGLint configCount = 0;
+	eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount);
+	if (configCount == 0 && !(surfaceless && hasEglExtension(extensions, "EGL_KHR_no_config_context"))) {
+		std::cout << "No usable EGL config" << std::endl;
+		return false;
+	}
+
+	//the compatibility profile glad was generated for
+	EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext eglContext = eglCreateContext(eglDisplay, configCount > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT) {
+		std::cout << "Failed to create EGL context: " << std::hex << eglGetError() << std::dec << std::endl;
+		return false;
+	}
+	headlessContext = eglContext;
+	this->config = configCount > 0 ? config : EGL_NO_CONFIG_KHR;
+
+	//everything renders into the fbo, the pbuffer only exists because some drivers want a surface to be current
+	EGLSurface eglSurface = EGL_NO_SURFACE;
+	if (!surfaceless) {
+		EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+		eglSurface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttributes);
+		surface = eglSurface;
+	}
+	if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext)) {
+		std::cout << "Failed to make EGL context current: " << std::hex << eglGetError() << std::dec << std::endl;
+		return false;
+	}
+	loadProc = eglLoad;
+	if (!gladLoadGLLoader(loadProc)) {
+		std::cout << "Failed to initalize GLAD" << std::endl;
+		return false;
+	}
+	std::cout << "headless: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+	return createFramebuffer();
+}
+
+bool RenderContext::createSharedContext()
+{
+	if (sharedContext) {
+		return true;
+	}
+	if (window) {
+		//sdl makes the new context current, the window's goes back straight after
+		SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+		sharedContext = SDL_GL_CreateContext(window);
+		SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+		SDL_GL_MakeCurrent(window, windowContext);
+		if (sharedContext == NULL) {
+			std::cout << "Failed to create shared GL context: " << SDL_GetError() << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (!headlessContext) {
+		return false;
+	}
+	EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+	sharedContext = eglCreateContext(display, config, headlessContext, contextAttributes);
+	if (sharedContext == EGL_NO_CONTEXT) {
+		std::cout << "Failed to create shared EGL context: " << std::hex << eglGetError() << std::dec << std::endl;
+		sharedContext = nullptr;
+		return false;
+	}
+	//a surface can only be current on one thread, the loader gets a pbuffer of its own
+	if (surface) {
+		EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+		sharedSurface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+	}
+	return true;
+}
+
+bool RenderContext::makeSharedCurrent()
+{
+	if (!sharedContext) {
+		return false;
+	}
+	if (window) {
+		return SDL_GL_MakeCurrent(window, sharedContext) == 0;
+	}
+	//the api is per thread too, and new threads start out on gles
+	eglBindAPI(EGL_OPENGL_API);
+	EGLSurface eglSurface = sharedSurface ? sharedSurface : EGL_NO_SURFACE;
+	return eglMakeCurrent(display, eglSurface, eglSurface, sharedContext);
+}
+
+void RenderContext::releaseSharedCurrent()
+{
+	if (window) {
+		SDL_GL_MakeCurrent(window, NULL);
+	}
+	else if (display) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	}
+}
+
+void RenderContext::destroySharedContext()
+{
+	if (!sharedContext) {
+		return;
+	}
+	if (window) {
+		SDL_GL_DeleteContext(sharedContext);
+	}
+	else {
+		if (sharedSurface) {
+			eglDestroySurface(display, sharedSurface);
+		}
+		eglDestroyContext(display, sharedContext);
+	}
+	sharedContext = sharedSurface = nullptr;
+}
+
+bool RenderContext::createFramebuffer()
+{
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::FRAMEBUFFER::HEADLESS_TARGET_INCOMPLETE" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void RenderContext::bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void RenderContext::present()
+{
+	CPU_ZONE("present");
+	if (window) {
+		SDL_GL_SwapWindow(window);
+	}
+	else {
+		glFlush();
+	}
+	if (queueLimit == 0) {
+		glFinish();
+	}
+	else if (queueLimit > 0) {
+		//the slot this frame's fence goes into holds the one from queueLimit frames ago
+		GLsync& fence = queued[nextQueued];
+		if (fence) {
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+			glDeleteSync(fence);
+		}
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		nextQueued = (nextQueued + 1) % queueLimit;
+	}
+}
+
+bool RenderContext::setSwapInterval(int interval)
+{
+	if (!window) {
+		return false;
+	}
+	if (SDL_GL_SetSwapInterval(interval) == 0) {
+		return true;
+	}
+	if (interval < 0 && SDL_GL_SetSwapInterval(1) == 0) {
+		std::cout << "adaptive vsync isn't supported, using vsync" << std::endl;
+		return true;
+	}
+	std::cout << "Failed to set the swap interval: " << SDL_GetError() << std::endl;
+	return false;
+}
+
+void RenderContext::setFrameQueueLimit(int frames)
+{
+	for (GLsync fence : queued) {
+		if (fence) {
+			glDeleteSync(fence);
+		}
+	}
+	queueLimit = frames;
+	queued.assign(frames > 0 ? frames : 0, nullptr);
+	nextQueued = 0;
+}
+
+void RenderContext::destroy()
+{
+	setFrameQueueLimit(-1);
+	destroySharedContext();
+	if (fbo) {
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		fbo = colorBuffer = depthBuffer = 0;
+	}
+	if (headlessContext) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (surface) {
+			eglDestroySurface(display, surface);
+		}
+		eglDestroyContext(display, headlessContext);
+		eglTerminate(display);
+		headlessContext = surface = display = config = nullptr;
+	}
+	if (windowContext) {
+		SDL_GL_DeleteContext(windowContext);
+		windowContext = nullptr;
+	}
+	if (window) {
+		SDL_DestroyWindow(window);
+		window = nullptr;
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+struct SDL_Window;
+
+//where the frames go: a normal sdl window, or (headless) an fbo in a surfaceless egl context
+//so the same scene can run on machines without a display, e.g. mesa's llvmpipe on a build box
+class RenderContext
+{
+public:
+	SDL_Window* window = nullptr;
+	int width = 0;
+	int height = 0;
+
+	//both create the context, make it current and load glad
+	bool createWindow(const char* title, int width, int height);
+	bool createHeadless(int width, int height);
+	void destroy();
+
+	bool headless() const { return headlessContext != nullptr; }
+	GLADloadproc loader() const { return loadProc; }
+	//a second context in the object share group of this one, for a loader thread: what it creates (once its fence
+	//has signalled) can be used here. made on the render thread, then made current on the loader thread
+	bool createSharedContext();
+	//both on the loader thread, false if the context couldn't be made current
+	bool makeSharedCurrent();
+	void releaseSharedCurrent();
+	void destroySharedContext();
+
+	//the framebuffer the scene renders into, 0 for the window
+	unsigned int framebuffer() const { return fbo; }
+	//binds framebuffer() for drawing
+	void bind() const;
+	//swaps the window, headless frames just get flushed
+	void present();
+
+	//0 presents immediately, 1 waits for vsync, -1 is adaptive vsync (late frames tear instead of waiting
+	//a whole refresh), falls back to vsync where adaptive isn't supported, false for headless contexts
+	bool setSwapInterval(int interval);
+	//how many presented frames the cpu may run ahead of the gpu: -1 leaves it to the driver, 0 waits for
+	//every frame to finish (glFinish) & n waits on a fence from n frames back before going on
+	void setFrameQueueLimit(int frames);
+
+private:
+	void* windowContext = nullptr;
+	void* display = nullptr;
+	void* headlessContext = nullptr;
+	void* surface = nullptr;
+	void* config = nullptr;
+	void* sharedContext = nullptr;
+	void* sharedSurface = nullptr;
+	GLADloadproc loadProc = nullptr;
+	unsigned int fbo = 0;
+	unsigned int colorBuffer = 0;
+	unsigned int depthBuffer = 0;
+	int queueLimit = -1;
+	std::vector<GLsync> queued;
+	int nextQueued = 0;
+
+	bool createFramebuffer();
+};
+
+#endif // !CONTEXT_H
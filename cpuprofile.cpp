@@ -0,0 +1,201 @@
+#include "cpuprofile.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+std::atomic<bool> cpuProfilingOn(false);
+
+//zones kept per thread, older ones get overwritten once a thread has recorded more
+static const uint64_t bufferEvents = 1 << 15;
+
+struct ZoneEvent
+{
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+//written by one thread only, the exporter reads it behind the writer's back
+struct ThreadBuffer
+{
+	std::vector<ZoneEvent> events;
+	//total events ever written, the next one goes to events[written % bufferEvents]
+	std::atomic<uint64_t> written{0};
+	std::atomic<bool> inUse{true};
+	uint32_t thread = 0;
+	std::string name;
+};
+
+//buffers live until the process ends, a thread that exits hands its buffer to the next new thread with the
+//same name (so short lived workers, e.g. the mip generator's, share a few trace lanes instead of making new ones)
+static std::mutex buffersMutex;
+static std::vector<ThreadBuffer*> buffers;
+static uint64_t captureStart = 0;
+
+struct ThreadSlot
+{
+	ThreadBuffer* buffer = nullptr;
+	const char* name = nullptr;
+
+	~ThreadSlot()
+	{
+		if (buffer) {
+			buffer->inUse.store(false, std::memory_order_release);
+		}
+	}
+};
+static thread_local ThreadSlot threadSlot;
+
+static ThreadBuffer* acquireBuffer()
+{
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	ThreadBuffer* buffer = nullptr;
+	std::string name = threadSlot.name ? threadSlot.name : "";
+	for (ThreadBuffer* candidate : buffers) {
+		if (candidate->name == name && !candidate->inUse.load(std::memory_order_acquire)) {
+			buffer = candidate;
+			buffer->inUse.store(true, std::memory_order_relaxed);
+			break;
+		}
+	}
+	if (!buffer) {
+		buffer = new ThreadBuffer;
+		buffer->events.resize(bufferEvents);
+		buffer->thread = (uint32_t)buffers.size() + 1;
+		buffers.push_back(buffer);
+	}
+	buffer->name = name;
+	threadSlot.buffer = buffer;
+	return buffer;
+}
+
+uint64_t cpuProfileNow()
+{
+	return SDL_GetPerformanceCounter();
+}
+
+uint64_t cpuProfileBegin()
+{
+	if (!threadSlot.buffer) {
+		acquireBuffer();
+	}
+	return cpuProfileNow();
+}
+
+void cpuProfileRecord(const char* name, uint64_t start, uint64_t end)
+{
+	ThreadBuffer* buffer = threadSlot.buffer ? threadSlot.buffer : acquireBuffer();
+	uint64_t index = buffer->written.load(std::memory_order_relaxed);
+	buffer->events[index % bufferEvents] = {name, start, end};
+	//publishes the event to the exporter
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void setCpuProfileThreadName(const char* name)
+{
+	//only remembered until the thread records its first zone, so naming a thread costs nothing while profiling is off
+	threadSlot.name = name;
+	if (threadSlot.buffer) {
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		threadSlot.buffer->name = name;
+	}
+}
+
+void startCpuProfiling()
+{
+	captureStart = cpuProfileNow();
+	cpuProfilingOn.store(true, std::memory_order_relaxed);
+}
+
+bool cpuProfiling()
+{
+	return cpuProfilingOn.load(std::memory_order_relaxed);
+}
+
+//copies out the events of one buffer that were recorded since the capture started
+//anything the writer may have overwritten while copying is thrown away
+static void collectEvents(const ThreadBuffer& buffer, std::vector<ZoneEvent>& out)
+{
+	uint64_t end = buffer.written.load(std::memory_order_acquire);
+	uint64_t begin = end > bufferEvents ? end - bufferEvents : 0;
+	size_t first = out.size();
+	for (uint64_t i = begin; i < end; i++) {
+		out.push_back(buffer.events[i % bufferEvents]);
+	}
+	//the plain copies above mustn't move past the second load
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t after = buffer.written.load(std::memory_order_relaxed);
+	//the writer may already be filling slot after % bufferEvents, so the event in it is gone too
+	uint64_t overwritten = after + 1 > bufferEvents ? after + 1 - bufferEvents : 0;
+	if (overwritten > begin) {
+		out.erase(out.begin() + first, out.begin() + first + (size_t)std::min(overwritten - begin, end - begin));
+	}
+	out.erase(std::remove_if(out.begin() + first, out.end(), [](const ZoneEvent& event) { return event.start < captureStart; }), out.end());
+}
+
+bool stopCpuProfiling(const char* path)
+{
+	cpuProfilingOn.store(false, std::memory_order_relaxed);
+	if (!path) {
+		return true;
+	}
+	std::ofstream out(path);
+	if (!out) {
+		std::cout << "ERROR::CPUPROFILE::COULD_NOT_WRITE " << path << std::endl;
+		return false;
+	}
+	double microseconds = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	bool first = true;
+	size_t total = 0;
+	std::vector<ZoneEvent> events;
+	for (const ThreadBuffer* buffer : buffers) {
+		out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->thread
+			<< ", \"args\": {\"name\": \"" << (buffer->name.empty() ? "thread " + std::to_string(buffer->thread) : buffer->name) << "\"}}";
+		first = false;
+		events.clear();
+		collectEvents(*buffer, events);
+		for (const ZoneEvent& event : events) {
+			out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->thread
+				<< ", \"ts\": " << (event.start - captureStart) * microseconds << ", \"dur\": " << (event.end - event.start) * microseconds << "}";
+		}
+		total += events.size();
+	}
+	out << "\n]}\n";
+	std::cout << "wrote " << total << " cpu zones to " << path << std::endl;
+	return (bool)out;
+}
+
+void benchmarkCpuZones()
+{
+	const int iterations = 10000000;
+	volatile int sink = 0;
+	auto time = [&](auto body) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < iterations; i++) {
+			body(i);
+		}
+		return (double)(SDL_GetPerformanceCounter() - start) * 1000000000.0 / (double)SDL_GetPerformanceFrequency() / iterations;
+	};
+
+	double empty = time([&](int i) { sink = i; });
+	double off = time([&](int i) { CPU_ZONE("benchmark"); sink = i; });
+	startCpuProfiling();
+	double on = time([&](int i) { CPU_ZONE("benchmark"); sink = i; });
+	stopCpuProfiling(NULL);
+
+	std::cout << "cpu zones, " << iterations << " iterations:" << std::endl;
+	std::cout << "  empty loop: " << empty << " ns" << std::endl;
+	std::cout << "  profiling off: " << off << " ns (+" << off - empty << " ns per zone)" << std::endl;
+	std::cout << "  profiling on: " << on << " ns (+" << on - empty << " ns per zone)" << std::endl;
+}
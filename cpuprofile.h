@@ -0,0 +1,59 @@
+#ifndef CPUPROFILE_H
+#define CPUPROFILE_H
+
+#include <atomic>
+#include <cstdint>
+
+//scoped cpu timing zones that end up in a chrome trace_event json (opens in perfetto / chrome://tracing)
+//each thread writes its zones into its own ring buffer without locks, the buffers are only read on export
+//while profiling is off a zone costs one relaxed atomic load and a branch
+
+extern std::atomic<bool> cpuProfilingOn;
+
+uint64_t cpuProfileNow();
+//makes sure the thread has a buffer, returns the start time
+uint64_t cpuProfileBegin();
+void cpuProfileRecord(const char* name, uint64_t start, uint64_t end);
+
+class CpuZone
+{
+public:
+	//name has to outlive the export (a string literal)
+	explicit CpuZone(const char* name)
+	{
+		if (cpuProfilingOn.load(std::memory_order_relaxed)) {
+			zoneName = name;
+			start = cpuProfileBegin();
+		}
+	}
+	~CpuZone()
+	{
+		if (zoneName) {
+			cpuProfileRecord(zoneName, start, cpuProfileNow());
+		}
+	}
+	CpuZone(const CpuZone&) = delete;
+	CpuZone& operator=(const CpuZone&) = delete;
+
+private:
+	const char* zoneName = nullptr;
+	uint64_t start = 0;
+};
+
+#define CPU_ZONE_JOIN2(a, b) a##b
+#define CPU_ZONE_JOIN(a, b) CPU_ZONE_JOIN2(a, b)
+//times the rest of the enclosing scope
+#define CPU_ZONE(name) CpuZone CPU_ZONE_JOIN(cpuZone, __LINE__)(name)
+
+//starts recording, zones from before this aren't exported
+void startCpuProfiling();
+//stops recording and writes everything since startCpuProfiling as a trace_event json
+bool stopCpuProfiling(const char* path);
+bool cpuProfiling();
+//the name the calling thread gets in the trace
+void setCpuProfileThreadName(const char* name);
+
+//times empty zones with profiling off and on against an empty loop and prints the cost per zone
+void benchmarkCpuZones();
+
+#endif // !CPUPROFILE_H
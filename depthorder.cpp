@@ -0,0 +1,257 @@
+#include "depthorder.h"
+#include "cpuprofile.h"
+#include "gpuprofile.h"
+#include "renderstats.h"
+
+#include <algorithm>
+#include <iostream>
+
+//auto switches to the prepass once sorting still leaves this much overdraw, and back once it's down to the lower one
+//(the prepass draws every triangle twice, with few hidden fragments that costs more than it saves)
+static const double prepassAbove = 1.25;
+static const double sortedBelow = 1.1;
+
+bool parseDepthMode(const std::string& name, DepthMode& mode)
+{
+	const DepthMode modes[] = {DepthMode::Unsorted, DepthMode::Sorted, DepthMode::Prepass, DepthMode::Auto};
+	for (DepthMode candidate : modes) {
+		if (name == depthModeName(candidate)) {
+			mode = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* depthModeName(DepthMode mode)
+{
+	switch (mode) {
+	case DepthMode::Sorted:
+		return "sorted";
+	case DepthMode::Prepass:
+		return "prepass";
+	case DepthMode::Auto:
+		return "auto";
+	default:
+		return "unsorted";
+	}
+}
+
+DepthOrdering::DepthOrdering()
+{
+}
+
+DepthOrdering::~DepthOrdering()
+{
+	destroy();
+}
+
+bool DepthOrdering::create(const std::filesystem::path& shaderDir)
+{
+	destroy();
+	//the scene's own vertex shader, so the depth the prepass writes is exactly what the colour pass tests against
+	countShader.reset(new Shader((shaderDir / "shader.vs").c_str(), (shaderDir / "overdraw.fs").c_str()));
+	//the scene's vertex array has the position in attribute 0
+	if (glGetAttribLocation(countShader->ID, "aPos") != 0) {
+		std::cout << "ERROR::DEPTHORDER::POSITION_NOT_ATTRIBUTE_0" << std::endl;
+	}
+	heatShader.reset(new Shader((shaderDir / "bake.vs").c_str(), (shaderDir / "overdrawview.fs").c_str()));
+	heatShader->use();
+	//the same unit the other full screen passes use, the scene's textures stay where they are
+	heatShader->setInt("counts", 7);
+	glUseProgram(0);
+	glGenVertexArrays(1, &vertexArray);
+	return true;
+}
+
+void DepthOrdering::destroy()
+{
+	if (vertexArray) {
+		glDeleteVertexArrays(1, &vertexArray);
+		vertexArray = 0;
+	}
+	if (countShader) {
+		glDeleteProgram(countShader->ID);
+		countShader.reset();
+	}
+	if (heatShader) {
+		glDeleteProgram(heatShader->ID);
+		heatShader.reset();
+	}
+}
+
+void DepthOrdering::setMode(DepthMode chosen)
+{
+	requested = chosen;
+	//auto starts out sorted, it's never worse than unsorted
+	active = chosen == DepthMode::Auto ? DepthMode::Sorted : chosen;
+	untilMeasure = 0;
+}
+
+void DepthOrdering::beginFrame(const std::vector<glm::mat4>& models, const glm::mat4& view, bool forceMeasure)
+{
+	measureThisFrame = forceMeasure;
+	if (requested == DepthMode::Auto) {
+		measureThisFrame = measureThisFrame || untilMeasure <= 0;
+		untilMeasure = measureThisFrame ? interval : untilMeasure - 1;
+	}
+	measureThisFrame = measureThisFrame && created();
+
+	if (unsorted.size() != models.size()) {
+		unsorted.resize(models.size());
+		for (size_t i = 0; i < unsorted.size(); i++) {
+			unsorted[i] = (unsigned int)i;
+		}
+	}
+	if (active == DepthMode::Unsorted && !measureThisFrame) {
+		return;
+	}
+	CPU_ZONE("depth sort");
+	//the cube's centre along the view direction, the cubes are small enough for that to be their depth
+	depths.resize(models.size());
+	for (size_t i = 0; i < models.size(); i++) {
+		depths[i] = -(view * models[i][3]).z;
+	}
+	sorted = unsorted;
+	std::sort(sorted.begin(), sorted.end(), [this](unsigned int a, unsigned int b) {
+		return depths[a] != depths[b] ? depths[a] < depths[b] : a < b;
+	});
+}
+
+void DepthOrdering::draw(Shader& sceneShader, const SceneDraw& drawScene, GpuProfiler* profiler)
+{
+	if (active == DepthMode::Prepass && created()) {
+		//depth only: no colour writes, and the fragment shader is the trivial counting one
+		profiler->beginPass("depth prepass");
+		countShader->use();
+		colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		drawScene(*countShader, sorted);
+		colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		profiler->endPass();
+
+		//only the nearest fragment of each pixel matches the depth already there
+		depthFunc(GL_EQUAL);
+		depthMask(GL_FALSE);
+		profiler->beginPass("cubes");
+		sceneShader.use();
+		drawScene(sceneShader, sorted);
+		profiler->endPass();
+		depthMask(GL_TRUE);
+		depthFunc(GL_LESS);
+		return;
+	}
+	profiler->beginPass("cubes");
+	sceneShader.use();
+	drawScene(sceneShader, order(active));
+	profiler->endPass();
+}
+
+void DepthOrdering::drawCounted(DepthMode counted, const SceneDraw& drawScene)
+{
+	if (counted == DepthMode::Prepass) {
+		colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		drawScene(*countShader, sorted);
+		colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		depthFunc(GL_EQUAL);
+		depthMask(GL_FALSE);
+		drawScene(*countShader, sorted);
+		depthMask(GL_TRUE);
+		depthFunc(GL_LESS);
+		return;
+	}
+	drawScene(*countShader, order(counted));
+}
+
+void DepthOrdering::measure(const SceneDraw& drawScene, int width, int height)
+{
+	CPU_ZONE("overdraw");
+	//every fragment that passes the depth test adds 1/255 to its pixel
+	clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	enableState(GL_BLEND);
+	blendFunc(GL_ONE, GL_ONE);
+	countShader->use();
+	//the mode in use goes last, its counts are what stays in the target for the heat map
+	DepthMode modes[3];
+	int count = 0;
+	for (DepthMode measured : {DepthMode::Unsorted, DepthMode::Sorted, DepthMode::Prepass}) {
+		if (measured != active) {
+			modes[count++] = measured;
+		}
+	}
+	modes[count] = active;
+	for (DepthMode measured : modes) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		drawCounted(measured, drawScene);
+		samples[(int)measured] = readCounts(width, height);
+	}
+	disableState(GL_BLEND);
+	measureCount++;
+	choose();
+}
+
+OverdrawSample DepthOrdering::readCounts(int width, int height)
+{
+	//waits for the gpu, which is why this only runs when asked for
+	counts.resize((size_t)width * height * 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, counts.data());
+	OverdrawSample sample;
+	for (size_t i = 0; i < counts.size(); i += 4) {
+		sample.shaded += counts[i];
+		sample.covered += counts[i] != 0;
+	}
+	return sample;
+}
+
+void DepthOrdering::choose()
+{
+	if (requested != DepthMode::Auto) {
+		return;
+	}
+	double sortedOverdraw = samples[(int)DepthMode::Sorted].ratio();
+	DepthMode next = active;
+	if (active != DepthMode::Prepass && sortedOverdraw > prepassAbove) {
+		next = DepthMode::Prepass;
+	}
+	else if (active == DepthMode::Prepass && sortedOverdraw < sortedBelow) {
+		next = DepthMode::Sorted;
+	}
+	if (next != active) {
+		active = next;
+		switchCount++;
+	}
+}
+
+void DepthOrdering::showHeat(unsigned int countTexture)
+{
+	int previousVertexArray, previousProgram, previousUnit;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &previousUnit);
+	disableState(GL_DEPTH_TEST);
+
+	heatShader->use();
+	activeTexture(GL_TEXTURE7);
+	bindTexture(GL_TEXTURE_2D, countTexture);
+	glBindVertexArray(vertexArray);
+	drawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindVertexArray(previousVertexArray);
+	activeTexture(previousUnit);
+	useProgram(previousProgram);
+	enableState(GL_DEPTH_TEST);
+}
+
+void printOverdraw(std::ostream& out, const DepthOrdering& ordering)
+{
+	out << "overdraw:";
+	const DepthMode modes[] = {DepthMode::Unsorted, DepthMode::Sorted, DepthMode::Prepass};
+	for (DepthMode measured : modes) {
+		out << (measured == DepthMode::Unsorted ? " " : ", ") << depthModeName(measured) << " " << ordering.sample(measured).ratio();
+	}
+	out << " fragments per pixel (" << ordering.sample(DepthMode::Unsorted).covered << " pixels covered), drawing "
+		<< depthModeName(ordering.activeMode());
+	if (ordering.mode() == DepthMode::Auto) {
+		out << " (auto, " << ordering.switches() << " switches)";
+	}
+	out << std::endl;
+}
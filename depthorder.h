@@ -0,0 +1,116 @@
+#ifndef DEPTHORDER_H
+#define DEPTHORDER_H
+
+#include "shader.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class GpuProfiler;
+
+//how the opaque cubes get drawn so hidden fragments run the scene's fragment shader as little as possible
+enum class DepthMode
+{
+	Unsorted,  // in cube order, whatever is in front
+	Sorted,    // front to back by view depth, so nearer cubes fill the depth buffer first
+	Prepass,   // depth only first, then colour with GL_EQUAL so every pixel is shaded exactly once
+	Auto       // sorted or prepass, whichever the measured overdraw says
+};
+
+//false (mode untouched) for anything but unsorted, sorted, prepass or auto
+bool parseDepthMode(const std::string& name, DepthMode& mode);
+const char* depthModeName(DepthMode mode);
+
+//fragments that passed the depth test against the pixels anything covered
+struct OverdrawSample
+{
+	uint64_t shaded = 0;
+	uint64_t covered = 0;
+
+	//fragments shaded per covered pixel, 1 is no overdraw at all
+	double ratio() const { return covered ? (double)shaded / covered : 0.0; }
+};
+
+//draws the scene's geometry with the (already bound) program, cube indices in the given order
+typedef std::function<void(Shader& shader, const std::vector<unsigned int>& order)> SceneDraw;
+
+//picks the draw order & depth passes of the scene, and measures what each one costs in shaded fragments:
+//the overdraw pass draws the scene into a debug target with additive blending, every fragment that passes the
+//depth test adding one to its pixel, and reads it back (a stall, so auto only measures every so often)
+class DepthOrdering
+{
+public:
+	DepthOrdering();
+	~DepthOrdering();
+	DepthOrdering(const DepthOrdering&) = delete;
+	DepthOrdering& operator=(const DepthOrdering&) = delete;
+
+	//the depth only & counting programs are shaderDir/shader.vs with shaderDir/overdraw.fs, the heat map is
+	//shaderDir/bake.vs & shaderDir/overdrawview.fs
+	bool create(const std::filesystem::path& shaderDir);
+	void destroy();
+	bool created() const { return countShader != nullptr; }
+
+	void setMode(DepthMode chosen);
+	DepthMode mode() const { return requested; }
+	//what this frame draws with, auto resolved to sorted or prepass
+	DepthMode activeMode() const { return active; }
+	//auto measures every this many frames (and on the first)
+	void setMeasureInterval(int frames) { interval = frames; }
+
+	//sorts the cubes by their distance along the view direction, decides whether this frame measures
+	void beginFrame(const std::vector<glm::mat4>& models, const glm::mat4& view, bool forceMeasure);
+	//whether the overdraw pass should run this frame
+	bool measuring() const { return measureThisFrame; }
+
+	//draws the scene with the active mode into the bound framebuffer, depth already cleared
+	void draw(Shader& sceneShader, const SceneDraw& drawScene, GpuProfiler* profiler);
+
+	//with a cleared rgba8 count & depth target bound: counts unsorted, sorted & prepass in turn, leaves the active
+	//mode's counts in the target & lets auto pick its next mode from them
+	void measure(const SceneDraw& drawScene, int width, int height);
+	//draws the count texture as a heat map over the bound framebuffer
+	void showHeat(unsigned int countTexture);
+
+	//the last measurement of each mode, auto itself has none
+	const OverdrawSample& sample(DepthMode measured) const { return samples[(int)measured]; }
+	//measurements so far & how often auto changed its mind
+	int measurements() const { return measureCount; }
+	int switches() const { return switchCount; }
+
+private:
+	std::unique_ptr<Shader> countShader;
+	std::unique_ptr<Shader> heatShader;
+	unsigned int vertexArray = 0;
+
+	DepthMode requested = DepthMode::Unsorted;
+	DepthMode active = DepthMode::Unsorted;
+	int interval = 120;
+	int untilMeasure = 0;
+	bool measureThisFrame = false;
+	int measureCount = 0;
+	int switchCount = 0;
+
+	std::vector<unsigned int> unsorted;
+	std::vector<unsigned int> sorted;
+	std::vector<float> depths;
+	OverdrawSample samples[3];
+	std::vector<unsigned char> counts;
+
+	const std::vector<unsigned int>& order(DepthMode drawn) const { return drawn == DepthMode::Unsorted ? unsorted : sorted; }
+	void drawCounted(DepthMode counted, const SceneDraw& drawScene);
+	OverdrawSample readCounts(int width, int height);
+	void choose();
+};
+
+//one line: shaded fragments per covered pixel of each mode, and the one in use
+void printOverdraw(std::ostream& out, const DepthOrdering& ordering);
+
+#endif // !DEPTHORDER_H
@@ -0,0 +1,139 @@
+#include "dynres.h"
+#include "renderstats.h"
+
+#include <algorithm>
+#include <cmath>
+
+//the scale aims a bit under the budget so ordinary jitter doesn't push frames over it
+static const double budgetHeadroom = 0.9;
+//and only grows back once frames are well under it, so it doesn't flip between two sizes
+static const double growThreshold = 0.75;
+//frames after a change before the frame time is trusted again (the frames queued up were still the old size)
+static const int settleFrames = 8;
+//render sizes are kept to multiples of this, tiny changes aren't worth a blurrier or sharper frame
+static const int sizeStep = 8;
+
+DynamicResolution::DynamicResolution()
+{
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	destroy();
+}
+
+bool DynamicResolution::create(const std::filesystem::path& shaderDir, int w, int h)
+{
+	destroy();
+	upscale.reset(new Shader((shaderDir / "bake.vs").c_str(), (shaderDir / "upscale.fs").c_str()));
+	upscale->use();
+	//a unit of its own, the scene's textures & samplers stay bound where they are
+	upscale->setInt("scene", 7);
+	glUseProgram(0);
+	//the triangle comes from gl_VertexID, the vertex array is only there to be bound
+	glGenVertexArrays(1, &vertexArray);
+	setOutputSize(w, h);
+	return true;
+}
+
+void DynamicResolution::destroy()
+{
+	if (vertexArray) {
+		glDeleteVertexArrays(1, &vertexArray);
+		vertexArray = 0;
+	}
+	if (upscale) {
+		glDeleteProgram(upscale->ID);
+		upscale.reset();
+	}
+}
+
+void DynamicResolution::setOutputSize(int w, int h)
+{
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+	outputWidth = w;
+	outputHeight = h;
+	applyScale(currentScale);
+}
+
+void DynamicResolution::setScaleRange(double minimum, double maximum)
+{
+	maxScale = std::min(std::max(maximum, 0.05), 1.0);
+	minScale = std::min(std::max(minimum, 0.05), maxScale);
+	applyScale(currentScale);
+}
+
+void DynamicResolution::setScale(double scale)
+{
+	applyScale(scale);
+}
+
+void DynamicResolution::applyScale(double scale)
+{
+	currentScale = std::min(std::max(scale, minScale), maxScale);
+	int w = (int)std::lround(outputWidth * currentScale / sizeStep) * sizeStep;
+	int h = (int)std::lround(outputHeight * currentScale / sizeStep) * sizeStep;
+	width = std::min(std::max(w, std::min(sizeStep, outputWidth)), outputWidth);
+	height = std::min(std::max(h, std::min(sizeStep, outputHeight)), outputHeight);
+}
+
+void DynamicResolution::update(double frameMs)
+{
+	if (budget <= 0.0 || frameMs <= 0.0) {
+		return;
+	}
+	if (settling > 0) {
+		settling--;
+		smoothedMs = frameMs;
+		return;
+	}
+	smoothedMs = smoothedMs > 0.0 ? smoothedMs + (frameMs - smoothedMs) * 0.2 : frameMs;
+	if (smoothedMs <= budget && smoothedMs >= budget * growThreshold) {
+		return;
+	}
+	//pixels go with the square of the scale, so the scale goes with the root of the time ratio
+	double ratio = std::sqrt(budget * budgetHeadroom / smoothedMs);
+	//drops fast when over budget, grows back slowly
+	ratio = std::min(std::max(ratio, 0.7), 1.1);
+	int previousWidth = width;
+	int previousHeight = height;
+	applyScale(currentScale * ratio);
+	if (width != previousWidth || height != previousHeight) {
+		changeCount++;
+		settling = settleFrames;
+	}
+}
+
+void DynamicResolution::begin()
+{
+	viewport(0, 0, width, height);
+	//keeps the clear to the part that gets rendered
+	glScissor(0, 0, width, height);
+	enableState(GL_SCISSOR_TEST);
+}
+
+void DynamicResolution::resolve(unsigned int sceneTexture)
+{
+	disableState(GL_SCISSOR_TEST);
+	disableState(GL_DEPTH_TEST);
+
+	int previousVertexArray, previousProgram, previousUnit;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &previousUnit);
+
+	useProgram(upscale->ID);
+	upscale->setVec2("uvScale", (float)width / outputWidth, (float)height / outputHeight);
+	upscale->setVec2("uvMax", (width - 0.5f) / outputWidth, (height - 0.5f) / outputHeight);
+	activeTexture(GL_TEXTURE7);
+	bindTexture(GL_TEXTURE_2D, sceneTexture);
+	glBindVertexArray(vertexArray);
+	drawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindVertexArray(previousVertexArray);
+	activeTexture(previousUnit);
+	useProgram(previousProgram);
+	enableState(GL_DEPTH_TEST);
+}
@@ -0,0 +1,70 @@
+#ifndef DYNRES_H
+#define DYNRES_H
+
+#include "shader.h"
+
+#include <filesystem>
+#include <memory>
+
+//renders the scene at a fraction of the window's resolution and upscales it to the window in one bilinear pass,
+//with the fraction picked each frame so the frame time stays under a budget
+//(on llvmpipe fragment cost goes with the pixel count, so the scale is the knob that matters)
+//the scene's target is the full output size and the scene renders into its lower left corner, so changing the
+//scale never reallocates anything (the render graph keeps handing out the same texture)
+class DynamicResolution
+{
+public:
+	DynamicResolution();
+	~DynamicResolution();
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	//the upscale shader is shaderDir/bake.vs & shaderDir/upscale.fs
+	bool create(const std::filesystem::path& shaderDir, int outputWidth, int outputHeight);
+	void destroy();
+	bool created() const { return upscale != nullptr; }
+	//the window changed size, the render size follows
+	void setOutputSize(int outputWidth, int outputHeight);
+
+	//budgetMs 0 keeps the scale fixed
+	void setBudget(double budgetMs) { budget = budgetMs; }
+	void setScaleRange(double minimum, double maximum);
+	//the scale to start from (or stay at without a budget), a fraction of the output width & height
+	void setScale(double scale);
+
+	//feeds back the last frame's time, may pick a new scale for the next one
+	void update(double frameMs);
+
+	//with the scene's full size target bound: viewport & scissor on the part the scene renders into
+	void begin();
+	//draws the rendered part of sceneTexture over the whole bound framebuffer & puts back the state it changed
+	void resolve(unsigned int sceneTexture);
+
+	double scale() const { return currentScale; }
+	int renderWidth() const { return width; }
+	int renderHeight() const { return height; }
+	//times the scale changed
+	int changes() const { return changeCount; }
+
+private:
+	std::unique_ptr<Shader> upscale;
+	unsigned int vertexArray = 0;
+	int outputWidth = 0;
+	int outputHeight = 0;
+	int width = 0;
+	int height = 0;
+
+	double budget = 0.0;
+	double minScale = 0.5;
+	double maxScale = 1.0;
+	double currentScale = 1.0;
+	//frame time smoothed over a few frames, so one slow frame doesn't make the picture jump
+	double smoothedMs = 0.0;
+	//frames left before measurements count again, the ones in flight were rendered at the old scale
+	int settling = 0;
+	int changeCount = 0;
+
+	void applyScale(double scale);
+};
+
+#endif // !DYNRES_H
@@ -0,0 +1,341 @@
+#include "framecapture.h"
+#include "cpuprofile.h"
+#include "hash.h"
+
+#include <png.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+//frames waiting for the encoder before capture() holds the render loop back (each one is a whole frame of pixels)
+static const size_t maxQueuedFrames = 8;
+
+FrameCapture::FrameCapture(int depth, int encoders) : depth(depth < 2 ? 2 : depth), encoders(encoders)
+{
+	if (this->encoders <= 0) {
+		this->encoders = std::max(1u, std::thread::hardware_concurrency() / 4);
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	finish();
+}
+
+bool FrameCapture::start(const char* path, FrameFormat frameFormat, int frameWidth, int frameHeight)
+{
+	finish();
+	std::error_code error;
+	std::filesystem::create_directories(path, error);
+	if (error) {
+		std::cout << "ERROR::FRAMECAPTURE::COULD_NOT_CREATE " << path << std::endl;
+		return false;
+	}
+	directory = path;
+	format = frameFormat;
+	width = frameWidth;
+	height = frameHeight;
+	frame = 0;
+	next = 0;
+	inFlight = 0;
+	counts = FrameCaptureStats();
+	hashes.clear();
+	jobs.resize(maxQueuedFrames);
+	firstJob = 0;
+	queuedJobs = 0;
+
+	//GL_STREAM_READ: written by the gpu once, read by us once
+	//past the frames in flight, every frame queued for or being worked on by an encoder keeps its buffer mapped
+	slots.resize(depth + maxQueuedFrames + encoders);
+	for (Slot& slot : slots) {
+		glGenBuffers(1, &slot.pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	stopping = false;
+	for (int i = 0; i < encoders; i++) {
+		workers.push_back(std::thread(&FrameCapture::work, this));
+	}
+	return true;
+}
+
+bool FrameCapture::collect(bool wait)
+{
+	if (inFlight == 0) {
+		return false;
+	}
+	int slotIndex = (next - inFlight + (int)slots.size()) % (int)slots.size();
+	Slot& slot = slots[slotIndex];
+	GLenum status = glClientWaitSync(slot.fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		if (!wait) {
+			return false;
+		}
+		counts.fenceWaits++;
+		//the flush makes sure the fence actually gets to the gpu, a second is plenty for one frame
+		status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+	}
+	if (status == GL_WAIT_FAILED || status == GL_TIMEOUT_EXPIRED) {
+		std::cout << "ERROR::FRAMECAPTURE::FENCE_WAIT_FAILED frame " << slot.frame << std::endl;
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+	inFlight--;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (queuedJobs >= maxQueuedFrames) {
+			counts.encoderWaits++;
+			drained.wait(lock, [this] { return queuedJobs < maxQueuedFrames; });
+		}
+	}
+
+	//no copy here, the encoder reads the mapped buffer itself & it's unmapped once it's done with it
+	size_t size = (size_t)width * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!pixels) {
+		std::cout << "ERROR::FRAMECAPTURE::MAP_FAILED frame " << slot.frame << std::endl;
+		//the frame still gets its line in hashes.txt, a gap would shift every later frame against a reference
+		std::lock_guard<std::mutex> lock(mutex);
+		hashes.push_back(std::make_pair(slot.frame, 0));
+		counts.unreadable++;
+		return true;
+	}
+	slot.mapped = true;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		slot.encoding = true;
+		jobs[(firstJob + queuedJobs++) % maxQueuedFrames] = Job{slot.frame, slotIndex, (const unsigned char*)pixels};
+	}
+	wake.notify_one();
+	return true;
+}
+
+void FrameCapture::unmapEncoded(bool all)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Slot& slot : slots) {
+		if (slot.mapped && (all || !slot.encoding)) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			slot.mapped = false;
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::capture(unsigned int framebuffer)
+{
+	if (!active()) {
+		return;
+	}
+	CPU_ZONE("frame capture");
+	//whatever finished since last time goes to the encoder, in order
+	while (collect(false)) {
+	}
+	//the ring is full, the oldest frame has to come out before its buffer can be reused
+	if (inFlight == depth) {
+		collect(true);
+	}
+
+	Slot& slot = slots[next];
+	{
+		//only when the encoders are a whole ring behind, the queue limit in collect() normally holds things back first
+		std::unique_lock<std::mutex> lock(mutex);
+		if (slot.encoding) {
+			counts.encoderWaits++;
+			drained.wait(lock, [&slot] { return !slot.encoding; });
+		}
+	}
+	unmapEncoded(false);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	//with a pack buffer bound this only queues the copy, the pointer is an offset into the buffer
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame = frame++;
+	next = (next + 1) % (int)slots.size();
+	inFlight++;
+	counts.captured++;
+}
+
+void FrameCapture::resize(int frameWidth, int frameHeight)
+{
+	if (!active() || (frameWidth == width && frameHeight == height)) {
+		return;
+	}
+	while (collect(true)) {
+	}
+	{
+		//the encoders go by width & height, and the buffers they read are about to be reallocated
+		std::unique_lock<std::mutex> lock(mutex);
+		drained.wait(lock, [this] {
+			return queuedJobs == 0 && std::none_of(slots.begin(), slots.end(), [](const Slot& slot) { return slot.encoding; });
+		});
+	}
+	unmapEncoded(true);
+	width = frameWidth;
+	height = frameHeight;
+	for (Slot& slot : slots) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::finish()
+{
+	if (!active()) {
+		return;
+	}
+	while (collect(true)) {
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+
+	unmapEncoded(true);
+	for (Slot& slot : slots) {
+		glDeleteBuffers(1, &slot.pbo);
+	}
+	slots.clear();
+	jobs.clear();
+
+	std::string listPath = directory + "/hashes.txt";
+	//encoders finish out of order
+	std::sort(hashes.begin(), hashes.end());
+	std::ofstream list(listPath);
+	for (const std::pair<int, uint64_t>& hash : hashes) {
+		list << hash.first << " " << (hash.second == 0 ? "unreadable" : hashToString(hash.second)) << "\n";
+	}
+	if (!list) {
+		std::cout << "ERROR::FRAMECAPTURE::COULD_NOT_WRITE " << listPath << std::endl;
+	}
+	std::cout << "frame capture: " << counts.captured << " frames, " << counts.written << " written to " << directory << ", "
+		<< counts.fenceWaits << " fence waits, " << counts.encoderWaits << " encoder waits";
+	if (counts.unreadable > 0) {
+		std::cout << ", " << counts.unreadable << " could not be read back";
+	}
+	std::cout << std::endl;
+}
+
+void FrameCapture::work()
+{
+	setCpuProfileThreadName("frame capture");
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || queuedJobs > 0; });
+			if (queuedJobs == 0) {
+				return;
+			}
+			job = std::move(jobs[firstJob]);
+			firstJob = (firstJob + 1) % maxQueuedFrames;
+			queuedJobs--;
+		}
+		drained.notify_one();
+
+		bool written;
+		uint64_t hash;
+		{
+			CPU_ZONE("encode frame");
+			//hashed as read back, bottom row first
+			hash = hashWords(job.pixels, (size_t)width * height * 4);
+			written = write(job);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			hashes.push_back(std::make_pair(job.frame, hash));
+			counts.written += written;
+			slots[job.slot].encoding = false;
+		}
+		//capture() may be waiting for this buffer
+		drained.notify_one();
+	}
+}
+
+// libpng reports errors by longjmp-ing out of whatever call failed
+static bool writePng(FILE* file, png_structp png, png_infop info, int width, int height, png_bytep* rows)
+{
+	if (setjmp(png_jmpbuf(png))) {
+		return false;
+	}
+	png_init_io(png, file);
+	//frames are big & written every frame, a light deflate keeps the encoder ahead of the render loop
+	png_set_compression_level(png, 1);
+	png_set_compression_strategy(png, Z_RLE);
+	png_set_filter(png, 0, PNG_FILTER_SUB);
+	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+		PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+	png_write_image(png, rows);
+	png_write_end(png, NULL);
+	return true;
+}
+
+bool FrameCapture::write(const Job& job)
+{
+	if (format == FrameFormat::Hash) {
+		return false;
+	}
+	char name[64];
+	if (format == FrameFormat::Png) {
+		snprintf(name, sizeof(name), "/frame_%06d.png", job.frame);
+	}
+	else {
+		snprintf(name, sizeof(name), "/frame_%06d_%dx%d.rgba", job.frame, width, height);
+	}
+	std::string path = directory + name;
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file) {
+		std::cout << "ERROR::FRAMECAPTURE::COULD_NOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	//gl reads bottom row first, files store the top row first
+	size_t stride = (size_t)width * 4;
+	std::vector<png_bytep> rows(height);
+	for (int y = 0; y < height; y++) {
+		rows[y] = (png_bytep)job.pixels + (height - 1 - y) * stride;
+	}
+
+	bool written = true;
+	if (format == FrameFormat::Png) {
+		png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		png_infop info = png ? png_create_info_struct(png) : NULL;
+		written = info && writePng(file, png, info, width, height, rows.data());
+		png_destroy_write_struct(&png, &info);
+	}
+	else {
+		for (int y = 0; y < height && written; y++) {
+			written = fwrite(rows[y], 1, stride, file) == stride;
+		}
+	}
+	if (fclose(file) != 0 || !written) {
+		std::cout << "ERROR::FRAMECAPTURE::COULD_NOT_WRITE " << path << std::endl;
+		return false;
+	}
+	return true;
+}
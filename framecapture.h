@@ -0,0 +1,109 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//what happens to each captured frame
+enum class FrameFormat
+{
+	Png,  // frame_000000.png
+	Raw,  // frame_000000_<w>x<h>.rgba, tightly packed rgba rows, top row first
+	Hash  // nothing but the line in hashes.txt
+};
+
+struct FrameCaptureStats
+{
+	int captured = 0;
+	int written = 0;
+	//times the ring wrapped onto a frame the gpu hadn't finished, capture() waited on its fence
+	int fenceWaits = 0;
+	//times the encoder fell behind and capture() waited for it to catch up
+	int encoderWaits = 0;
+	//frames whose buffer couldn't be mapped, hashes.txt says "unreadable" for them
+	int unreadable = 0;
+};
+
+//saves every frame without stalling the render loop on glReadPixels
+//the read goes into a ring of pixel pack buffers, each guarded by a fence, and a frame is only mapped once
+//its fence has signalled (normally a frame or two later), the mapped buffer is then handed to a worker thread
+//that hashes it & encodes it straight from there, every frame's hash ends up in hashes.txt for visual regression checks
+//(a png takes longer to deflate than a frame takes to render, so there are a few encoder threads)
+class FrameCapture
+{
+public:
+	//depth: frames in flight before the ring wraps, encoders: worker threads, 0 picks a quarter of the cores
+	explicit FrameCapture(int depth = 3, int encoders = 0);
+	~FrameCapture();
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	//frames go into directory (created if needed), width & height is the size of what gets read
+	bool start(const char* directory, FrameFormat format, int width, int height);
+	bool active() const { return !slots.empty(); }
+	//queues a read of the framebuffer's color, call after the frame was drawn & before presenting it
+	void capture(unsigned int framebuffer);
+	//the window changed size: drains what's in flight at the old size, later frames are read at the new one
+	void resize(int width, int height);
+	//reads back what's still in flight, waits for the encoder and writes hashes.txt
+	void finish();
+
+	const FrameCaptureStats& stats() const { return counts; }
+
+private:
+	struct Slot
+	{
+		GLuint pbo = 0;
+		GLsync fence = nullptr;
+		int frame = 0;
+		//mapped is the gl thread's, encoding is shared: an encoder is still reading the mapped buffer
+		bool mapped = false;
+		bool encoding = false;
+	};
+	struct Job
+	{
+		int frame;
+		int slot;
+		const unsigned char* pixels;
+	};
+
+	int depth;
+	int encoders;
+	std::vector<Slot> slots;
+	int next = 0;
+	int inFlight = 0;
+	int frame = 0;
+	int width = 0;
+	int height = 0;
+	FrameFormat format = FrameFormat::Png;
+	std::string directory;
+	FrameCaptureStats counts;
+
+	//the encoders, jobs, slots' encoding flags & hashes are shared with them
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable drained;
+	//a ring of queued frames (a deque would allocate a block every few frames), oldest at firstJob
+	std::vector<Job> jobs;
+	size_t firstJob = 0;
+	size_t queuedJobs = 0;
+	bool stopping = false;
+	std::vector<std::pair<int, uint64_t>> hashes;
+
+	//maps the oldest frame in flight if its fence signalled (or waits for it), false if it wasn't ready
+	bool collect(bool wait);
+	//unmaps the buffers the encoders are done with (all of them once they've stopped), on the gl thread
+	void unmapEncoded(bool all);
+	void work();
+	bool write(const Job& job);
+};
+
+#endif // !FRAMECAPTURE_H
@@ -0,0 +1,471 @@
+#include "glcapture.h"
+#include "texture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+static FILE* captureFile = NULL;
+//records for the current frame, written out in one go when it ends
+static std::vector<unsigned char> pending;
+//puts each wrapped entry point back
+static std::vector<std::function<void()>> restores;
+
+//what the wrappers need to know to tell a pointer argument from a buffer offset
+static GLint unpackAlignment = 4;
+static GLuint unpackBuffer = 0;
+static GLuint packBuffer = 0;
+struct Mapping
+{
+	GLenum target;
+	void* pointer;
+	GLsizeiptr length;
+};
+static std::vector<Mapping> mappings;
+
+size_t glCapturePixelBytes(int width, int height, GLenum format, GLenum type, int alignment)
+{
+	size_t components = 4;
+	switch (format) {
+	case GL_RED:
+	case GL_DEPTH_COMPONENT:
+		components = 1;
+		break;
+	case GL_RG:
+		components = 2;
+		break;
+	case GL_RGB:
+	case GL_BGR:
+		components = 3;
+		break;
+	}
+	size_t size = 1;
+	switch (type) {
+	case GL_HALF_FLOAT:
+	case GL_UNSIGNED_SHORT:
+		size = 2;
+		break;
+	case GL_FLOAT:
+	case GL_UNSIGNED_INT:
+	case GL_INT:
+		size = 4;
+		break;
+	}
+	size_t row = (size_t)width * components * size;
+	row = (row + alignment - 1) / alignment * alignment;
+	return row * height;
+}
+
+template <typename T>
+static void put(T value)
+{
+	static_assert(std::is_arithmetic_v<T>, "only plain values go into the stream");
+	const unsigned char* bytes = (const unsigned char*)&value;
+	pending.insert(pending.end(), bytes, bytes + sizeof(T));
+}
+
+static void putBytes(const void* data, size_t size)
+{
+	put((uint32_t)size);
+	const unsigned char* bytes = (const unsigned char*)data;
+	pending.insert(pending.end(), bytes, bytes + size);
+}
+
+static void putOp(GlCaptureOp op)
+{
+	put((uint8_t)op);
+}
+
+//client memory is copied, data already in a buffer object is referenced by offset
+static void putPixels(const void* pixels, GLuint buffer, size_t size)
+{
+	if (buffer) {
+		put((uint8_t)1);
+		put((uint64_t)(uintptr_t)pixels);
+	}
+	else if (pixels) {
+		put((uint8_t)2);
+		putBytes(pixels, size);
+	}
+	else {
+		put((uint8_t)0);
+	}
+}
+
+template <typename F>
+static void install(F& slot, F& real, F wrapper)
+{
+	if (!slot) {
+		return;
+	}
+	real = slot;
+	slot = wrapper;
+	restores.push_back([&slot, &real]() { slot = real; });
+}
+
+template <GlCaptureOp op, typename F>
+struct ValueCall;
+
+template <GlCaptureOp op, typename R, typename... A>
+struct ValueCall<op, R (APIENTRYP)(A...)>
+{
+	static inline R (APIENTRYP real)(A...) = nullptr;
+
+	static R APIENTRY call(A... args)
+	{
+		putOp(op);
+		(put(args), ...);
+		if constexpr (op == GLCAPTURE_glPixelStorei) {
+			trackPixelStore(args...);
+		}
+		if constexpr (op == GLCAPTURE_glBindBuffer) {
+			trackBuffer(args...);
+		}
+		return real(args...);
+	}
+
+	static void trackPixelStore(GLenum name, GLint value)
+	{
+		if (name == GL_UNPACK_ALIGNMENT) {
+			unpackAlignment = value;
+		}
+	}
+
+	static void trackBuffer(GLenum target, GLuint buffer)
+	{
+		if (target == GL_PIXEL_UNPACK_BUFFER) {
+			unpackBuffer = buffer;
+		}
+		else if (target == GL_PIXEL_PACK_BUFFER) {
+			packBuffer = buffer;
+		}
+	}
+};
+
+template <GlCaptureOp op, typename F>
+struct NameCall
+{
+	static inline F real = nullptr;
+
+	//glGen* records the names after the driver picked them, glDelete* before they're gone
+	static void APIENTRY gen(GLsizei n, GLuint* names)
+	{
+		real(n, names);
+		putOp(op);
+		put(n);
+		for (GLsizei i = 0; i < n; i++) {
+			put(names[i]);
+		}
+	}
+
+	static void APIENTRY del(GLsizei n, const GLuint* names)
+	{
+		putOp(op);
+		put(n);
+		for (GLsizei i = 0; i < n; i++) {
+			put(names[i]);
+		}
+		real(n, names);
+	}
+};
+
+template <GlCaptureOp op, int floats>
+struct UniformCall
+{
+	static inline PFNGLUNIFORM4FVPROC real = nullptr;
+
+	static void APIENTRY call(GLint location, GLsizei count, const GLfloat* value)
+	{
+		putOp(op);
+		put(location);
+		put(count);
+		putBytes(value, sizeof(GLfloat) * floats * count);
+		real(location, count, value);
+	}
+};
+
+template <GlCaptureOp op, int floats>
+struct MatrixCall
+{
+	static inline PFNGLUNIFORMMATRIX4FVPROC real = nullptr;
+
+	static void APIENTRY call(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+	{
+		putOp(op);
+		put(location);
+		put(count);
+		put(transpose);
+		putBytes(value, sizeof(GLfloat) * floats * count);
+		real(location, count, transpose, value);
+	}
+};
+
+static PFNGLCREATESHADERPROC realCreateShader;
+static GLuint APIENTRY captureCreateShader(GLenum type)
+{
+	GLuint shader = realCreateShader(type);
+	putOp(GLCAPTURE_glCreateShader);
+	put(type);
+	put(shader);
+	return shader;
+}
+
+static PFNGLCREATEPROGRAMPROC realCreateProgram;
+static GLuint APIENTRY captureCreateProgram()
+{
+	GLuint program = realCreateProgram();
+	putOp(GLCAPTURE_glCreateProgram);
+	put(program);
+	return program;
+}
+
+static PFNGLSHADERSOURCEPROC realShaderSource;
+static void APIENTRY captureShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths)
+{
+	//the pieces are joined into one string
+	std::string source;
+	for (GLsizei i = 0; i < count; i++) {
+		source.append(strings[i], lengths && lengths[i] >= 0 ? (size_t)lengths[i] : strlen(strings[i]));
+	}
+	putOp(GLCAPTURE_glShaderSource);
+	put(shader);
+	putBytes(source.data(), source.size());
+	realShaderSource(shader, count, strings, lengths);
+}
+
+static PFNGLGETUNIFORMLOCATIONPROC realGetUniformLocation;
+static GLint APIENTRY captureGetUniformLocation(GLuint program, const GLchar* name)
+{
+	//recorded so the replay can map this location to the one its own program has
+	GLint location = realGetUniformLocation(program, name);
+	putOp(GLCAPTURE_glGetUniformLocation);
+	put(program);
+	putBytes(name, strlen(name));
+	put(location);
+	return location;
+}
+
+static PFNGLBUFFERDATAPROC realBufferData;
+static void APIENTRY captureBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	putOp(GLCAPTURE_glBufferData);
+	put(target);
+	put((int64_t)size);
+	put(usage);
+	put((uint8_t)(data != NULL));
+	if (data) {
+		putBytes(data, size);
+	}
+	realBufferData(target, size, data, usage);
+}
+
+static PFNGLMAPBUFFERRANGEPROC realMapBufferRange;
+static void* APIENTRY captureMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	putOp(GLCAPTURE_glMapBufferRange);
+	put(target);
+	put((int64_t)offset);
+	put((int64_t)length);
+	put(access);
+	void* pointer = realMapBufferRange(target, offset, length, access);
+	//what the app writes through the pointer is picked up on unmap
+	if (pointer && (access & GL_MAP_WRITE_BIT)) {
+		mappings.push_back({target, pointer, length});
+	}
+	return pointer;
+}
+
+static PFNGLUNMAPBUFFERPROC realUnmapBuffer;
+static GLboolean APIENTRY captureUnmapBuffer(GLenum target)
+{
+	putOp(GLCAPTURE_glUnmapBuffer);
+	put(target);
+	bool written = false;
+	for (size_t i = 0; i < mappings.size(); i++) {
+		if (mappings[i].target == target) {
+			putBytes(mappings[i].pointer, mappings[i].length);
+			mappings.erase(mappings.begin() + i);
+			written = true;
+			break;
+		}
+	}
+	if (!written) {
+		put((uint32_t)0);
+	}
+	return realUnmapBuffer(target);
+}
+
+static PFNGLVERTEXATTRIBPOINTERPROC realVertexAttribPointer;
+static void APIENTRY captureVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+	//always an offset into the bound GL_ARRAY_BUFFER, client side arrays aren't supported
+	putOp(GLCAPTURE_glVertexAttribPointer);
+	put(index);
+	put(size);
+	put(type);
+	put(normalized);
+	put(stride);
+	put((uint64_t)(uintptr_t)pointer);
+	realVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+static PFNGLDRAWELEMENTSPROC realDrawElements;
+static void APIENTRY captureDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+	//an offset into the bound GL_ELEMENT_ARRAY_BUFFER like above
+	putOp(GLCAPTURE_glDrawElements);
+	put(mode);
+	put(count);
+	put(type);
+	put((uint64_t)(uintptr_t)indices);
+	realDrawElements(mode, count, type, indices);
+}
+
+static PFNGLDRAWBUFFERSPROC realDrawBuffers;
+static void APIENTRY captureDrawBuffers(GLsizei n, const GLenum* buffers)
+{
+	putOp(GLCAPTURE_glDrawBuffers);
+	putBytes(buffers, sizeof(GLenum) * n);
+	realDrawBuffers(n, buffers);
+}
+
+static PFNGLTEXIMAGE2DPROC realTexImage2D;
+static void APIENTRY captureTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	putOp(GLCAPTURE_glTexImage2D);
+	put(target);
+	put(level);
+	put(internalformat);
+	put(width);
+	put(height);
+	put(border);
+	put(format);
+	put(type);
+	putPixels(pixels, unpackBuffer, glCapturePixelBytes(width, height, format, type, unpackAlignment));
+	realTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+static PFNGLTEXSUBIMAGE2DPROC realTexSubImage2D;
+static void APIENTRY captureTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	putOp(GLCAPTURE_glTexSubImage2D);
+	put(target);
+	put(level);
+	put(x);
+	put(y);
+	put(width);
+	put(height);
+	put(format);
+	put(type);
+	putPixels(pixels, unpackBuffer, glCapturePixelBytes(width, height, format, type, unpackAlignment));
+	realTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+static PFNGLREADPIXELSPROC realReadPixels;
+static void APIENTRY captureReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+{
+	//the pixels coming back don't matter to the replay, only that it reads them too
+	putOp(GLCAPTURE_glReadPixels);
+	put(x);
+	put(y);
+	put(width);
+	put(height);
+	put(format);
+	put(type);
+	put((uint8_t)(packBuffer != 0));
+	put((uint64_t)(packBuffer ? (uintptr_t)pixels : 0));
+	realReadPixels(x, y, width, height, format, type, pixels);
+}
+
+static void writePending()
+{
+	if (captureFile && !pending.empty()) {
+		fwrite(pending.data(), 1, pending.size(), captureFile);
+	}
+	pending.clear();
+}
+
+bool startGlCapture(const char* path, int width, int height)
+{
+	if (captureFile) {
+		stopGlCapture();
+	}
+	captureFile = fopen(path, "wb");
+	if (!captureFile) {
+		std::cout << "ERROR::GLCAPTURE::COULD_NOT_WRITE " << path << std::endl;
+		return false;
+	}
+	GlCaptureHeader header = {{'G', 'L', 'C', 'P'}, glCaptureVersion, (uint32_t)width, (uint32_t)height};
+	fwrite(&header, sizeof(header), 1, captureFile);
+
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, (GLint*)&unpackBuffer);
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, (GLint*)&packBuffer);
+
+#define GLCAPTURE_INSTALL_VALUE(name, spec) \
+	install(glad_##name, ValueCall<GLCAPTURE_##name, decltype(glad_##name)>::real, ValueCall<GLCAPTURE_##name, decltype(glad_##name)>::call);
+#define GLCAPTURE_INSTALL_NAME(genName, deleteName, kind) \
+	install(glad_##genName, NameCall<GLCAPTURE_##genName, decltype(glad_##genName)>::real, NameCall<GLCAPTURE_##genName, decltype(glad_##genName)>::gen); \
+	install(glad_##deleteName, NameCall<GLCAPTURE_##deleteName, decltype(glad_##deleteName)>::real, NameCall<GLCAPTURE_##deleteName, decltype(glad_##deleteName)>::del);
+#define GLCAPTURE_INSTALL_UNIFORM(name, floats) \
+	install(glad_##name, UniformCall<GLCAPTURE_##name, floats>::real, UniformCall<GLCAPTURE_##name, floats>::call);
+#define GLCAPTURE_INSTALL_MATRIX(name, floats) \
+	install(glad_##name, MatrixCall<GLCAPTURE_##name, floats>::real, MatrixCall<GLCAPTURE_##name, floats>::call);
+	GLCAPTURE_VALUE_CALLS(GLCAPTURE_INSTALL_VALUE)
+	GLCAPTURE_NAME_CALLS(GLCAPTURE_INSTALL_NAME)
+	GLCAPTURE_UNIFORM_CALLS(GLCAPTURE_INSTALL_UNIFORM)
+	GLCAPTURE_MATRIX_CALLS(GLCAPTURE_INSTALL_MATRIX)
+#undef GLCAPTURE_INSTALL_VALUE
+#undef GLCAPTURE_INSTALL_NAME
+#undef GLCAPTURE_INSTALL_UNIFORM
+#undef GLCAPTURE_INSTALL_MATRIX
+	install(glad_glCreateShader, realCreateShader, captureCreateShader);
+	install(glad_glCreateProgram, realCreateProgram, captureCreateProgram);
+	install(glad_glShaderSource, realShaderSource, captureShaderSource);
+	install(glad_glGetUniformLocation, realGetUniformLocation, captureGetUniformLocation);
+	install(glad_glBufferData, realBufferData, captureBufferData);
+	install(glad_glMapBufferRange, realMapBufferRange, captureMapBufferRange);
+	install(glad_glUnmapBuffer, realUnmapBuffer, captureUnmapBuffer);
+	install(glad_glVertexAttribPointer, realVertexAttribPointer, captureVertexAttribPointer);
+	install(glad_glDrawElements, realDrawElements, captureDrawElements);
+	install(glad_glDrawBuffers, realDrawBuffers, captureDrawBuffers);
+	install(glad_glTexImage2D, realTexImage2D, captureTexImage2D);
+	install(glad_glTexSubImage2D, realTexSubImage2D, captureTexSubImage2D);
+	install(glad_glReadPixels, realReadPixels, captureReadPixels);
+	install(texStorage2D, ValueCall<GLCAPTURE_glTexStorage2D, TexStorage2DProc>::real, ValueCall<GLCAPTURE_glTexStorage2D, TexStorage2DProc>::call);
+	return true;
+}
+
+void glCaptureFrame()
+{
+	if (!captureFile) {
+		return;
+	}
+	putOp(GLCAPTURE_FRAME);
+	writePending();
+}
+
+void stopGlCapture()
+{
+	if (!captureFile) {
+		return;
+	}
+	for (std::function<void()>& restore : restores) {
+		restore();
+	}
+	restores.clear();
+	mappings.clear();
+	putOp(GLCAPTURE_END);
+	writePending();
+	fclose(captureFile);
+	captureFile = NULL;
+}
+
+bool glCapturing()
+{
+	return captureFile != NULL;
+}
@@ -0,0 +1,137 @@
+#ifndef GLCAPTURE_H
+#define GLCAPTURE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+//records every gl call the app makes into a compact binary file that glreplay plays back without the app
+//it works by swapping the glad function pointers (and texStorage2D) for wrappers that write the call and its
+//arguments, plus any pixels/vertices/shader source they point at, then forward to the driver
+//queries & getters aren't recorded, they don't change what gets rendered
+//(calls are expected on the thread that started the capture)
+
+//file layout: GlCaptureHeader, then records of one opcode byte followed by the arguments as raw little endian
+//values (pointed at data as a uint32 size and the bytes), a frame ends with GLCAPTURE_FRAME
+
+struct GlCaptureHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+};
+
+static const uint32_t glCaptureVersion = 4;
+
+//calls whose arguments are all plain values, the letters say what each argument is so the replay can swap
+//object names for the ones its own context made:
+//v value, b buffer, t texture, a vertex array, p program or shader, m sampler, f framebuffer, r renderbuffer,
+//l uniform location (of the program in use)
+#define GLCAPTURE_VALUE_CALLS(X) \
+	X(glViewport, "vvvv") \
+	X(glScissor, "vvvv") \
+	X(glEnable, "v") \
+	X(glDisable, "v") \
+	X(glDepthFunc, "v") \
+	X(glDepthMask, "v") \
+	X(glColorMask, "vvvv") \
+	X(glBlendFunc, "vv") \
+	X(glPolygonMode, "vv") \
+	X(glClearColor, "vvvv") \
+	X(glClear, "v") \
+	X(glPixelStorei, "vv") \
+	X(glActiveTexture, "v") \
+	X(glBindTexture, "vt") \
+	X(glTexParameteri, "vvv") \
+	X(glGenerateMipmap, "v") \
+	X(glBindSampler, "vm") \
+	X(glSamplerParameteri, "mvv") \
+	X(glBindBuffer, "vb") \
+	X(glBindVertexArray, "a") \
+	X(glEnableVertexAttribArray, "v") \
+	X(glBindFramebuffer, "vf") \
+	X(glDrawBuffer, "v") \
+	X(glBindRenderbuffer, "vr") \
+	X(glRenderbufferStorage, "vvvv") \
+	X(glFramebufferRenderbuffer, "vvvr") \
+	X(glFramebufferTexture2D, "vvvtv") \
+	X(glCompileShader, "p") \
+	X(glAttachShader, "pp") \
+	X(glLinkProgram, "p") \
+	X(glDeleteShader, "p") \
+	X(glDeleteProgram, "p") \
+	X(glUseProgram, "p") \
+	X(glUniform1i, "lv") \
+	X(glUniform1f, "lv") \
+	X(glUniform2f, "lvv") \
+	X(glUniform3f, "lvvv") \
+	X(glUniform4f, "lvvvv") \
+	X(glDrawArrays, "vvv")
+
+//glGen* / glDelete* and the kind of name they make
+#define GLCAPTURE_NAME_CALLS(X) \
+	X(glGenBuffers, glDeleteBuffers, 'b') \
+	X(glGenTextures, glDeleteTextures, 't') \
+	X(glGenVertexArrays, glDeleteVertexArrays, 'a') \
+	X(glGenSamplers, glDeleteSamplers, 'm') \
+	X(glGenFramebuffers, glDeleteFramebuffers, 'f') \
+	X(glGenRenderbuffers, glDeleteRenderbuffers, 'r')
+
+//glUniform*v with the floats per element
+#define GLCAPTURE_UNIFORM_CALLS(X) \
+	X(glUniform2fv, 2) \
+	X(glUniform3fv, 3) \
+	X(glUniform4fv, 4)
+
+#define GLCAPTURE_MATRIX_CALLS(X) \
+	X(glUniformMatrix2fv, 4) \
+	X(glUniformMatrix3fv, 9) \
+	X(glUniformMatrix4fv, 16)
+
+//the rest need their own code on both sides
+#define GLCAPTURE_OTHER_CALLS(X) \
+	X(glCreateShader) \
+	X(glCreateProgram) \
+	X(glShaderSource) \
+	X(glGetUniformLocation) \
+	X(glBufferData) \
+	X(glMapBufferRange) \
+	X(glUnmapBuffer) \
+	X(glVertexAttribPointer) \
+	X(glDrawElements) \
+	X(glDrawBuffers) \
+	X(glTexImage2D) \
+	X(glTexSubImage2D) \
+	X(glTexStorage2D) \
+	X(glReadPixels)
+
+enum GlCaptureOp : uint8_t
+{
+#define GLCAPTURE_OP(name, ...) GLCAPTURE_##name,
+#define GLCAPTURE_NAME_OPS(gen, del, kind) GLCAPTURE_##gen, GLCAPTURE_##del,
+	GLCAPTURE_VALUE_CALLS(GLCAPTURE_OP)
+	GLCAPTURE_NAME_CALLS(GLCAPTURE_NAME_OPS)
+	GLCAPTURE_UNIFORM_CALLS(GLCAPTURE_OP)
+	GLCAPTURE_MATRIX_CALLS(GLCAPTURE_OP)
+	GLCAPTURE_OTHER_CALLS(GLCAPTURE_OP)
+#undef GLCAPTURE_NAME_OPS
+#undef GLCAPTURE_OP
+	GLCAPTURE_FRAME,
+	GLCAPTURE_END
+};
+
+//bytes of pixel data glTexImage2D & friends read for a width x height image
+size_t glCapturePixelBytes(int width, int height, GLenum format, GLenum type, int alignment);
+
+//starts writing to path, everything the app does from here on is recorded
+//width & height are the size the replay should render at
+bool startGlCapture(const char* path, int width, int height);
+//marks the end of a frame (call after presenting)
+void glCaptureFrame();
+//puts the real entry points back and closes the file
+void stopGlCapture();
+bool glCapturing();
+
+#endif // !GLCAPTURE_H
@@ -0,0 +1,447 @@
+//plays back a gl capture made with main --capture as fast as the driver takes it and times every frame
+//usage: glreplay <capture file> [--finish]
+//--finish waits for the gpu at the end of every frame, otherwise frames are only flushed and the times are
+//what the driver costs on the cpu
+
+#include "glcapture.h"
+#include "context.h"
+#include "bench.h"
+#include "texture.h"
+
+#include <SDL2/SDL.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+struct Reader
+{
+	const unsigned char* data;
+	size_t size;
+	size_t position = 0;
+	bool ok = true;
+
+	template <typename T>
+	T get()
+	{
+		T value = T();
+		if (position + sizeof(T) > size) {
+			ok = false;
+			return value;
+		}
+		memcpy(&value, data + position, sizeof(T));
+		position += sizeof(T);
+		return value;
+	}
+
+	//points into the file, stays valid for the whole replay
+	const unsigned char* bytes(uint32_t& length)
+	{
+		length = get<uint32_t>();
+		if (!ok || position + length > size) {
+			ok = false;
+			length = 0;
+			return NULL;
+		}
+		const unsigned char* pointer = data + position;
+		position += length;
+		return pointer;
+	}
+};
+
+static RenderContext context;
+//captured object names to the ones this context made, one table per kind letter
+static std::unordered_map<GLuint, GLuint> names[128];
+//(program, captured location) to this context's location
+static std::unordered_map<uint64_t, GLint> locations;
+static GLuint currentProgram = 0;
+static GLuint lastProgram = 0;
+
+static GLuint mapName(char kind, GLuint name)
+{
+	std::unordered_map<GLuint, GLuint>& table = names[(int)kind];
+	auto found = table.find(name);
+	if (kind == 'f' && (name == 0 || found == table.end())) {
+		//the app's own render target wasn't captured, draw into ours instead
+		return context.framebuffer();
+	}
+	GLuint mapped = found == table.end() ? name : found->second;
+	if (kind == 'p') {
+		lastProgram = mapped;
+	}
+	return mapped;
+}
+
+static GLint mapLocation(GLint location)
+{
+	if (location < 0) {
+		return location;
+	}
+	auto found = locations.find((uint64_t)currentProgram << 32 | (uint32_t)location);
+	return found == locations.end() ? location : found->second;
+}
+
+template <typename T>
+static T remap(char kind, T value)
+{
+	if constexpr (std::is_integral_v<T>) {
+		if (kind == 'l') {
+			return (T)mapLocation((GLint)value);
+		}
+		if (kind != 'v') {
+			return (T)mapName(kind, (GLuint)value);
+		}
+	}
+	return value;
+}
+
+template <typename R, typename... A>
+static void replayValues(R (APIENTRYP function)(A...), const char* spec, Reader& in)
+{
+	std::tuple<A...> args;
+	int i = 0;
+	std::apply([&](A&... arg) { ((arg = remap(spec[i++], in.get<A>())), ...); }, args);
+	if (in.ok) {
+		std::apply(function, args);
+	}
+}
+
+template <typename F>
+static void replayGen(F function, char kind, Reader& in)
+{
+	GLsizei count = in.get<GLsizei>();
+	std::vector<GLuint> captured(count), made(count);
+	for (GLsizei i = 0; i < count; i++) {
+		captured[i] = in.get<GLuint>();
+	}
+	function(count, made.data());
+	for (GLsizei i = 0; i < count; i++) {
+		names[(int)kind][captured[i]] = made[i];
+	}
+}
+
+template <typename F>
+static void replayDelete(F function, char kind, Reader& in)
+{
+	GLsizei count = in.get<GLsizei>();
+	std::vector<GLuint> mapped(count);
+	for (GLsizei i = 0; i < count; i++) {
+		GLuint name = in.get<GLuint>();
+		mapped[i] = mapName(kind, name);
+		names[(int)kind].erase(name);
+	}
+	function(count, mapped.data());
+}
+
+static const void* replayPixels(Reader& in)
+{
+	uint8_t source = in.get<uint8_t>();
+	if (source == 1) {
+		return (const void*)(uintptr_t)in.get<uint64_t>();
+	}
+	if (source == 2) {
+		uint32_t length;
+		return in.bytes(length);
+	}
+	return NULL;
+}
+
+//the buffers currently mapped for writing, filled on unmap
+static std::unordered_map<GLenum, void*> mapped;
+static std::vector<unsigned char> readback;
+
+//replays one call, false at the end of the stream (or a broken one)
+static bool replayCall(Reader& in, GlCaptureOp& op)
+{
+	op = (GlCaptureOp)in.get<uint8_t>();
+	if (!in.ok) {
+		return false;
+	}
+	switch (op) {
+#define GLREPLAY_VALUE(name, spec) \
+	case GLCAPTURE_##name: \
+		replayValues(glad_##name, spec, in); \
+		break;
+	GLCAPTURE_VALUE_CALLS(GLREPLAY_VALUE)
+#undef GLREPLAY_VALUE
+#define GLREPLAY_NAME(gen, del, kind) \
+	case GLCAPTURE_##gen: \
+		replayGen(glad_##gen, kind, in); \
+		break; \
+	case GLCAPTURE_##del: \
+		replayDelete(glad_##del, kind, in); \
+		break;
+	GLCAPTURE_NAME_CALLS(GLREPLAY_NAME)
+#undef GLREPLAY_NAME
+#define GLREPLAY_UNIFORM(name, floats) \
+	case GLCAPTURE_##name: { \
+		GLint location = mapLocation(in.get<GLint>()); \
+		GLsizei count = in.get<GLsizei>(); \
+		uint32_t length; \
+		const GLfloat* value = (const GLfloat*)in.bytes(length); \
+		if (in.ok) { \
+			glad_##name(location, count, value); \
+		} \
+		break; \
+	}
+	GLCAPTURE_UNIFORM_CALLS(GLREPLAY_UNIFORM)
+#undef GLREPLAY_UNIFORM
+#define GLREPLAY_MATRIX(name, floats) \
+	case GLCAPTURE_##name: { \
+		GLint location = mapLocation(in.get<GLint>()); \
+		GLsizei count = in.get<GLsizei>(); \
+		GLboolean transpose = in.get<GLboolean>(); \
+		uint32_t length; \
+		const GLfloat* value = (const GLfloat*)in.bytes(length); \
+		if (in.ok) { \
+			glad_##name(location, count, transpose, value); \
+		} \
+		break; \
+	}
+	GLCAPTURE_MATRIX_CALLS(GLREPLAY_MATRIX)
+#undef GLREPLAY_MATRIX
+	case GLCAPTURE_glCreateShader: {
+		GLenum type = in.get<GLenum>();
+		GLuint shader = in.get<GLuint>();
+		names[(int)'p'][shader] = glCreateShader(type);
+		break;
+	}
+	case GLCAPTURE_glCreateProgram: {
+		GLuint program = in.get<GLuint>();
+		names[(int)'p'][program] = glCreateProgram();
+		break;
+	}
+	case GLCAPTURE_glShaderSource: {
+		GLuint shader = mapName('p', in.get<GLuint>());
+		uint32_t length;
+		const GLchar* source = (const GLchar*)in.bytes(length);
+		GLint sourceLength = (GLint)length;
+		glShaderSource(shader, 1, &source, &sourceLength);
+		break;
+	}
+	case GLCAPTURE_glGetUniformLocation: {
+		GLuint program = mapName('p', in.get<GLuint>());
+		uint32_t length;
+		const char* name = (const char*)in.bytes(length);
+		GLint location = in.get<GLint>();
+		if (in.ok && location >= 0) {
+			locations[(uint64_t)program << 32 | (uint32_t)location] = glGetUniformLocation(program, std::string(name, length).c_str());
+		}
+		break;
+	}
+	case GLCAPTURE_glBufferData: {
+		GLenum target = in.get<GLenum>();
+		GLsizeiptr size = (GLsizeiptr)in.get<int64_t>();
+		GLenum usage = in.get<GLenum>();
+		const void* data = NULL;
+		if (in.get<uint8_t>()) {
+			uint32_t length;
+			data = in.bytes(length);
+		}
+		glBufferData(target, size, data, usage);
+		break;
+	}
+	case GLCAPTURE_glMapBufferRange: {
+		GLenum target = in.get<GLenum>();
+		GLintptr offset = (GLintptr)in.get<int64_t>();
+		GLsizeiptr length = (GLsizeiptr)in.get<int64_t>();
+		GLbitfield access = in.get<GLbitfield>();
+		mapped[target] = glMapBufferRange(target, offset, length, access);
+		break;
+	}
+	case GLCAPTURE_glUnmapBuffer: {
+		GLenum target = in.get<GLenum>();
+		uint32_t length;
+		const unsigned char* data = in.bytes(length);
+		if (length && mapped[target]) {
+			memcpy(mapped[target], data, length);
+		}
+		mapped.erase(target);
+		glUnmapBuffer(target);
+		break;
+	}
+	case GLCAPTURE_glVertexAttribPointer: {
+		GLuint index = in.get<GLuint>();
+		GLint size = in.get<GLint>();
+		GLenum type = in.get<GLenum>();
+		GLboolean normalized = in.get<GLboolean>();
+		GLsizei stride = in.get<GLsizei>();
+		const void* pointer = (const void*)(uintptr_t)in.get<uint64_t>();
+		glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+		break;
+	}
+	case GLCAPTURE_glDrawElements: {
+		GLenum mode = in.get<GLenum>();
+		GLsizei count = in.get<GLsizei>();
+		GLenum type = in.get<GLenum>();
+		const void* indices = (const void*)(uintptr_t)in.get<uint64_t>();
+		glDrawElements(mode, count, type, indices);
+		break;
+	}
+	case GLCAPTURE_glDrawBuffers: {
+		uint32_t length;
+		const GLenum* buffers = (const GLenum*)in.bytes(length);
+		if (in.ok) {
+			glDrawBuffers(length / sizeof(GLenum), buffers);
+		}
+		break;
+	}
+	case GLCAPTURE_glTexImage2D: {
+		GLenum target = in.get<GLenum>();
+		GLint level = in.get<GLint>();
+		GLint internalFormat = in.get<GLint>();
+		GLsizei width = in.get<GLsizei>();
+		GLsizei height = in.get<GLsizei>();
+		GLint border = in.get<GLint>();
+		GLenum format = in.get<GLenum>();
+		GLenum type = in.get<GLenum>();
+		const void* pixels = replayPixels(in);
+		glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+		break;
+	}
+	case GLCAPTURE_glTexSubImage2D: {
+		GLenum target = in.get<GLenum>();
+		GLint level = in.get<GLint>();
+		GLint x = in.get<GLint>();
+		GLint y = in.get<GLint>();
+		GLsizei width = in.get<GLsizei>();
+		GLsizei height = in.get<GLsizei>();
+		GLenum format = in.get<GLenum>();
+		GLenum type = in.get<GLenum>();
+		const void* pixels = replayPixels(in);
+		glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+		break;
+	}
+	case GLCAPTURE_glTexStorage2D: {
+		GLenum target = in.get<GLenum>();
+		GLsizei levels = in.get<GLsizei>();
+		GLenum internalFormat = in.get<GLenum>();
+		GLsizei width = in.get<GLsizei>();
+		GLsizei height = in.get<GLsizei>();
+		if (!texStorage2D) {
+			std::cout << "ERROR::GLREPLAY::NO_TEXTURE_STORAGE" << std::endl;
+			return false;
+		}
+		texStorage2D(target, levels, internalFormat, width, height);
+		break;
+	}
+	case GLCAPTURE_glReadPixels: {
+		GLint x = in.get<GLint>();
+		GLint y = in.get<GLint>();
+		GLsizei width = in.get<GLsizei>();
+		GLsizei height = in.get<GLsizei>();
+		GLenum format = in.get<GLenum>();
+		GLenum type = in.get<GLenum>();
+		bool intoBuffer = in.get<uint8_t>();
+		uint64_t offset = in.get<uint64_t>();
+		void* pixels = (void*)(uintptr_t)offset;
+		if (!intoBuffer) {
+			//pack alignment is whatever it is, 8 covers every value gl allows
+			readback.resize(glCapturePixelBytes(width, height, format, type, 8));
+			pixels = readback.data();
+		}
+		glReadPixels(x, y, width, height, format, type, pixels);
+		break;
+	}
+	case GLCAPTURE_FRAME:
+		break;
+	case GLCAPTURE_END:
+		return false;
+	default:
+		std::cout << "ERROR::GLREPLAY::UNKNOWN_OPCODE " << (int)op << " at byte " << in.position - 1 << std::endl;
+		in.ok = false;
+		return false;
+	}
+	if (op == GLCAPTURE_glUseProgram) {
+		currentProgram = lastProgram;
+	}
+	return in.ok;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		std::cout << "usage: glreplay <capture file> [--finish]" << std::endl;
+		return 2;
+	}
+	bool finish = argc > 2 && std::string(argv[2]) == "--finish";
+
+	//the whole file is read up front so disk reads don't end up in the frame times
+	FILE* file = fopen(argv[1], "rb");
+	if (!file) {
+		std::cout << "ERROR::GLREPLAY::FILE_NOT_FOUND " << argv[1] << std::endl;
+		return 2;
+	}
+	std::vector<unsigned char> data;
+	unsigned char chunk[1 << 16];
+	size_t got;
+	while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		data.insert(data.end(), chunk, chunk + got);
+	}
+	fclose(file);
+
+	GlCaptureHeader header;
+	if (data.size() < sizeof(header) || (memcpy(&header, data.data(), sizeof(header)), memcmp(header.magic, "GLCP", 4) != 0)
+		|| header.version != glCaptureVersion) {
+		std::cout << "ERROR::GLREPLAY::NOT_A_CAPTURE " << argv[1] << std::endl;
+		return 2;
+	}
+
+	SDL_Init(SDL_INIT_TIMER);
+	if (!context.createHeadless(header.width, header.height)) {
+		context.destroy();
+		SDL_Quit();
+		return 1;
+	}
+	initTextureStorage(context.loader());
+	context.bind();
+
+	Reader in = {data.data() + sizeof(header), data.size() - sizeof(header)};
+	double frequency = (double)SDL_GetPerformanceFrequency();
+	std::vector<double> frameTimes;
+	double setupTime = 0.0;
+	bool loading = true;
+	uint64_t calls = 0;
+	GlCaptureOp op;
+	Uint64 start = SDL_GetPerformanceCounter();
+	while (replayCall(in, op)) {
+		calls++;
+		if (op != GLCAPTURE_FRAME) {
+			continue;
+		}
+		if (finish) {
+			glFinish();
+		}
+		else {
+			glFlush();
+		}
+		Uint64 now = SDL_GetPerformanceCounter();
+		//everything up to the first frame is loading
+		if (loading) {
+			setupTime = (now - start) * 1000.0 / frequency;
+			loading = false;
+		}
+		else {
+			frameTimes.push_back((now - start) * 1000.0 / frequency);
+		}
+		start = now;
+	}
+	glFinish();
+	if (!in.ok) {
+		std::cout << "capture ends early (truncated or corrupt)" << std::endl;
+	}
+
+	BenchStats stats = summarizeFrameTimes(frameTimes);
+	std::cout << "replayed " << calls << " calls, setup " << setupTime << " ms, " << frameTimes.size() << " frames"
+		<< (finish ? " (waiting for the gpu each frame)" : " (cpu side only)") << std::endl;
+	std::cout << "  frame ms: mean " << stats.mean << ", p50 " << stats.p50 << ", p95 " << stats.p95 << ", p99 " << stats.p99
+		<< ", max " << stats.max << std::endl;
+
+	context.destroy();
+	SDL_Quit();
+	return in.ok ? 0 : 1;
+}
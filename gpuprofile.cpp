@@ -0,0 +1,218 @@
+#include "gpuprofile.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+GpuProfiler::GpuProfiler(int latency, int window) : window(std::max(window, 1))
+{
+	frames.resize(std::max(latency, 2));
+}
+
+void GpuProfiler::enable()
+{
+	on = true;
+}
+
+void GpuProfiler::destroy()
+{
+	//the last few frames are still in flight, waiting is fine at this point
+	for (size_t i = 1; i <= frames.size(); i++) {
+		collect(frames[(current + i) % frames.size()], true);
+	}
+	for (Frame& frame : frames) {
+		if (!frame.queries.empty()) {
+			glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+		}
+		frame = Frame();
+	}
+	open.clear();
+	inFrame = false;
+	on = false;
+}
+
+int GpuProfiler::passIndex(const char* name)
+{
+	//a handful of passes, a linear search beats hashing the name every frame
+	for (size_t i = 0; i < history.size(); i++) {
+		if (history[i].name == name) {
+			return (int)i;
+		}
+	}
+	History entry;
+	entry.name = name;
+	entry.times.resize(window);
+	history.push_back(entry);
+	return (int)history.size() - 1;
+}
+
+unsigned int GpuProfiler::timestamp(Frame& frame)
+{
+	if (frame.used == (int)frame.queries.size()) {
+		unsigned int query;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+	unsigned int query = frame.queries[frame.used++];
+	glQueryCounter(query, GL_TIMESTAMP);
+	return query;
+}
+
+bool GpuProfiler::collect(Frame& frame, bool wait)
+{
+	if (!frame.pending) {
+		return true;
+	}
+	//timestamps land in submission order, so once the last one is there all of them are
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available && !wait) {
+		return false;
+	}
+	sums.assign(history.size(), -1.0);
+	for (const Timing& timing : frame.timings) {
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(timing.begin, GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(timing.end, GL_QUERY_RESULT, &end);
+		sums[timing.pass] = std::max(sums[timing.pass], 0.0) + (end - begin) / 1000000.0;
+	}
+	for (size_t i = 0; i < history.size(); i++) {
+		//passes that didn't run this frame don't count as 0
+		if (sums[i] < 0.0) {
+			continue;
+		}
+		History& entry = history[i];
+		entry.times[entry.next] = sums[i];
+		entry.next = (entry.next + 1) % window;
+		entry.count = std::min(entry.count + 1, window);
+		entry.last = sums[i];
+	}
+	frame.pending = false;
+	collected++;
+	return true;
+}
+
+void GpuProfiler::beginFrame()
+{
+	if (!on || inFrame) {
+		return;
+	}
+	//oldest first, stop at the first frame the gpu hasn't finished
+	for (size_t i = 1; i <= frames.size(); i++) {
+		if (!collect(frames[(current + i) % frames.size()], false)) {
+			break;
+		}
+	}
+	Frame& frame = frames[current];
+	if (frame.pending) {
+		//the gpu is more than the whole ring behind, drop the frame rather than wait for it
+		frame.pending = false;
+		dropped++;
+	}
+	frame.used = 0;
+	frame.timings.clear();
+	inFrame = true;
+	beginPass("frame");
+}
+
+void GpuProfiler::endFrame()
+{
+	if (!inFrame) {
+		return;
+	}
+	while (!open.empty()) {
+		endPass();
+	}
+	frames[current].pending = true;
+	current = (current + 1) % frames.size();
+	inFrame = false;
+}
+
+void GpuProfiler::beginPass(const char* name)
+{
+	if (!inFrame) {
+		return;
+	}
+	Frame& frame = frames[current];
+	Timing timing = {passIndex(name), timestamp(frame), 0};
+	open.push_back((int)frame.timings.size());
+	frame.timings.push_back(timing);
+}
+
+void GpuProfiler::endPass()
+{
+	if (!inFrame || open.empty()) {
+		return;
+	}
+	Frame& frame = frames[current];
+	frame.timings[open.back()].end = timestamp(frame);
+	open.pop_back();
+}
+
+GpuPassStats GpuProfiler::stats(const History& entry) const
+{
+	GpuPassStats result;
+	result.name = entry.name;
+	result.last = entry.last;
+	result.samples = entry.count;
+	double total = 0.0;
+	for (int i = 0; i < entry.count; i++) {
+		total += entry.times[i];
+		result.max = std::max(result.max, entry.times[i]);
+	}
+	result.average = entry.count ? total / entry.count : 0.0;
+	return result;
+}
+
+std::vector<GpuPassStats> GpuProfiler::passes() const
+{
+	std::vector<GpuPassStats> result;
+	for (const History& entry : history) {
+		result.push_back(stats(entry));
+	}
+	return result;
+}
+
+bool GpuProfiler::pass(const char* name, GpuPassStats& result) const
+{
+	for (const History& entry : history) {
+		if (entry.name == name) {
+			result = stats(entry);
+			return true;
+		}
+	}
+	return false;
+}
+
+void GpuProfiler::print() const
+{
+	std::cout << "gpu passes (last " << window << " frames, " << dropped << " dropped):" << std::endl;
+	for (const GpuPassStats& stats : passes()) {
+		std::cout << "  " << stats.name << ": avg " << stats.average << " ms, max " << stats.max << " ms, last "
+			<< stats.last << " ms (" << stats.samples << " frames)" << std::endl;
+	}
+}
+
+bool GpuProfiler::dump(const char* path) const
+{
+	std::ofstream out(path);
+	if (!out) {
+		std::cout << "ERROR::GPUPROFILER::COULD_NOT_WRITE " << path << std::endl;
+		return false;
+	}
+	std::vector<GpuPassStats> all = passes();
+	out << "{\n";
+	out << "\t\"latency_frames\": " << frames.size() << ",\n";
+	out << "\t\"window_frames\": " << window << ",\n";
+	out << "\t\"dropped_frames\": " << dropped << ",\n";
+	out << "\t\"passes\": [\n";
+	for (size_t i = 0; i < all.size(); i++) {
+		out << "\t\t{\"name\": \"" << all[i].name << "\", \"average_ms\": " << all[i].average << ", \"max_ms\": " << all[i].max
+			<< ", \"last_ms\": " << all[i].last << ", \"samples\": " << all[i].samples << "}" << (i + 1 < all.size() ? "," : "") << "\n";
+	}
+	out << "\t]\n";
+	out << "}\n";
+	return (bool)out;
+}
@@ -0,0 +1,97 @@
+#ifndef GPUPROFILE_H
+#define GPUPROFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//rolling gpu time of one named pass, in milliseconds
+struct GpuPassStats
+{
+	std::string name;
+	double last = 0.0;
+	double average = 0.0;
+	double max = 0.0;
+	//frames in the rolling window
+	int samples = 0;
+};
+
+//times named render passes on the gpu with GL_TIMESTAMP queries
+//every frame gets its own set of queries in a ring a few frames deep, and a frame's results are only read
+//once GL_QUERY_RESULT_AVAILABLE says they're there, so profiling never waits on the gpu
+//(if the ring wraps around before a frame finished, that frame is dropped instead)
+class GpuProfiler
+{
+public:
+	//latency: frames in flight before the ring wraps, window: frames the averages & maxima cover
+	explicit GpuProfiler(int latency = 4, int window = 120);
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	//profiling is off (and every call a no-op) until this is called
+	void enable();
+	bool enabled() const { return on; }
+	//reads back the frames still in flight and deletes the queries, the numbers stay readable
+	void destroy();
+
+	//the whole frame shows up as the pass "frame"
+	void beginFrame();
+	void endFrame();
+	//passes may nest, a name used more than once a frame adds up
+	void beginPass(const char* name);
+	void endPass();
+
+	//every pass seen so far, in the order they first showed up
+	std::vector<GpuPassStats> passes() const;
+	//false if no pass has that name (yet)
+	bool pass(const char* name, GpuPassStats& stats) const;
+	int droppedFrames() const { return dropped; }
+	//frames read back so far, when it goes up pass() has new numbers
+	int collectedFrames() const { return collected; }
+
+	void print() const;
+	//writes passes() as json
+	bool dump(const char* path) const;
+
+private:
+	struct Timing
+	{
+		int pass;
+		unsigned int begin;
+		unsigned int end;
+	};
+	struct Frame
+	{
+		std::vector<unsigned int> queries;
+		int used = 0;
+		std::vector<Timing> timings;
+		bool pending = false;
+	};
+	struct History
+	{
+		std::string name;
+		std::vector<double> times;
+		int next = 0;
+		int count = 0;
+		double last = 0.0;
+	};
+
+	bool on = false;
+	int window;
+	std::vector<Frame> frames;
+	int current = 0;
+	bool inFrame = false;
+	std::vector<int> open;
+	std::vector<History> history;
+	//per frame sums while collecting, one per pass
+	std::vector<double> sums;
+	int dropped = 0;
+	int collected = 0;
+
+	int passIndex(const char* name);
+	unsigned int timestamp(Frame& frame);
+	bool collect(Frame& frame, bool wait);
+	GpuPassStats stats(const History& history) const;
+};
+
+#endif // !GPUPROFILE_H
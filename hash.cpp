@@ -0,0 +1,64 @@
+#include "hash.h"
+
+#include <cstdio>
+#include <cstring>
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+uint64_t hashWords(const void* data, size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	//independent lanes so each multiply doesn't wait on the one before it
+	uint64_t lanes[4] = {hash, hash ^ 1, hash ^ 2, hash ^ 3};
+	size_t blocks = size / 32;
+	for (size_t i = 0; i < blocks; i++) {
+		for (int lane = 0; lane < 4; lane++) {
+			uint64_t word;
+			memcpy(&word, bytes + i * 32 + lane * 8, sizeof(word));
+			uint64_t mixed = (lanes[lane] ^ word) * 0x100000001b3ull;
+			//the multiply only carries upwards, this brings the high bits back down
+			lanes[lane] = mixed ^ (mixed >> 29);
+		}
+	}
+	for (uint64_t lane : lanes) {
+		hash = hashCombine(hash, lane);
+	}
+	return hashBytes(bytes + blocks * 32, size - blocks * 32, hash);
+}
+
+uint64_t hashFile(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return 0;
+	}
+	uint64_t hash = hashSeed;
+	unsigned char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		hash = hashBytes(buffer, read, hash);
+	}
+	bool failed = ferror(file);
+	fclose(file);
+	return failed ? 0 : hash;
+}
+
+uint64_t hashCombine(uint64_t hash, uint64_t value)
+{
+	return hashBytes(&value, sizeof(value), hash);
+}
+
+std::string hashToString(uint64_t hash)
+{
+	char text[17];
+	snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+	return text;
+}
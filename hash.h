@@ -0,0 +1,23 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//64 bit FNV-1a, good enough to key caches on, not meant to resist anyone on purpose
+const uint64_t hashSeed = 0xcbf29ce484222325ull;
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = hashSeed);
+//the same idea 8 bytes at a time on four lanes, several times faster for big buffers like whole frames
+//(gives different hashes than hashBytes, only compare it with itself)
+uint64_t hashWords(const void* data, size_t size, uint64_t hash = hashSeed);
+//hashes a whole file's contents, 0 if it can't be read
+uint64_t hashFile(const char* path);
+//folds one hash into another so the order of the inputs matters
+uint64_t hashCombine(uint64_t hash, uint64_t value);
+
+//16 hex digits, for file names
+std::string hashToString(uint64_t hash);
+
+#endif // !HASH_H
@@ -0,0 +1,252 @@
+#include "image.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <png.h>
+
+#include <csetjmp>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+struct ImageDecoder::PngState
+{
+	FILE* file = NULL;
+	png_structp read = NULL;
+	png_infop info = NULL;
+	int passes = 1;
+};
+
+ImageDecoder::ImageDecoder()
+{
+}
+
+ImageDecoder::~ImageDecoder()
+{
+	close();
+}
+
+void ImageDecoder::close()
+{
+	if (png) {
+		png_destroy_read_struct(&png->read, &png->info, NULL);
+		if (png->file) {
+			fclose(png->file);
+		}
+		delete png;
+		png = nullptr;
+	}
+	if (surface) {
+		SDL_FreeSurface(surface);
+		surface = nullptr;
+	}
+}
+
+// libpng reports errors by longjmp-ing out of whatever call failed
+static bool openPng(FILE* file, png_structp read, png_infop info, int& width, int& height, int& passes)
+{
+	if (setjmp(png_jmpbuf(read))) {
+		return false;
+	}
+	png_init_io(read, file);
+	png_set_sig_bytes(read, 8);
+	png_read_info(read, info);
+
+	png_byte colorType = png_get_color_type(read, info);
+	//expand everything to 8 bit rgba so the rows come out exactly as GL_RGBA/GL_UNSIGNED_BYTE
+	png_set_expand(read);
+	png_set_strip_16(read);
+	if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
+		png_set_gray_to_rgb(read);
+	}
+	if (!(colorType & PNG_COLOR_MASK_ALPHA) && !png_get_valid(read, info, PNG_INFO_tRNS)) {
+		png_set_filler(read, 0xff, PNG_FILLER_AFTER);
+	}
+	//interlaced images need every row visited once per pass, libpng merges them in place
+	passes = png_set_interlace_handling(read);
+	png_read_update_info(read, info);
+
+	width = png_get_image_width(read, info);
+	height = png_get_image_height(read, info);
+	return png_get_rowbytes(read, info) == (size_t)width * 4;
+}
+
+static bool decodePng(png_structp read, unsigned char* dst, size_t stride, int height, int passes)
+{
+	if (setjmp(png_jmpbuf(read))) {
+		return false;
+	}
+	for (int pass = 0; pass < passes; pass++) {
+		for (int y = 0; y < height; y++) {
+			png_read_row(read, dst + y * stride, NULL);
+		}
+	}
+	png_read_end(read, NULL);
+	return true;
+}
+
+bool ImageDecoder::open(const char* path)
+{
+	close();
+	width = 0;
+	height = 0;
+
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return false;
+	}
+	png_byte signature[8];
+	if (fread(signature, 1, 8, file) == 8 && png_sig_cmp(signature, 0, 8) == 0) {
+		png = new PngState;
+		png->file = file;
+		png->read = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		png->info = png->read ? png_create_info_struct(png->read) : NULL;
+		if (png->info && openPng(file, png->read, png->info, width, height, png->passes)) {
+			return true;
+		}
+		close();
+		return false;
+	}
+	fclose(file);
+
+	//not a png, let SDL_image decode it and convert on the way out
+	surface = IMG_Load(path);
+	if (!surface) {
+		return false;
+	}
+	width = surface->w;
+	height = surface->h;
+	return true;
+}
+
+size_t ImageDecoder::size() const
+{
+	return (size_t)width * height * 4;
+}
+
+bool ImageDecoder::readsBack() const
+{
+	return png && png->passes > 1;
+}
+
+bool ImageDecoder::decode(void* dst, size_t stride)
+{
+	bool success = false;
+	if (png) {
+		success = decodePng(png->read, (unsigned char*)dst, stride, height, png->passes);
+	}
+	else if (surface) {
+		//SDL_PIXELFORMAT_RGBA32 is the byte order r,g,b,a regardless of endianness
+		success = SDL_ConvertPixels(width, height, surface->format->format, surface->pixels, surface->pitch,
+			SDL_PIXELFORMAT_RGBA32, dst, (int)stride) == 0;
+	}
+	close();
+	return success;
+}
+
+bool uploadImageTexture(const char* path, int* width, int* height, ImageCopyStats* stats)
+{
+	ImageDecoder decoder;
+	if (!decoder.open(path)) {
+		return false;
+	}
+	size_t size = decoder.size();
+	if (width) {
+		*width = decoder.width;
+	}
+	if (height) {
+		*height = decoder.height;
+	}
+
+	if (decoder.readsBack()) {
+		std::vector<unsigned char> pixels(size);
+		if (!decoder.decode(pixels.data(), (size_t)decoder.width * 4)) {
+			return false;
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, decoder.width, decoder.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		if (stats) {
+			stats->decoded += size;
+			stats->uploaded += size;
+		}
+		return true;
+	}
+
+	unsigned int pbo;
+	glGenBuffers(1, &pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	bool success = dst && decoder.decode(dst, (size_t)decoder.width * 4);
+	//the buffer contents are undefined if unmapping fails (e.g. the context lost the memory)
+	if (dst && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+		success = false;
+	}
+	if (success) {
+		//rows are tightly packed, 4 byte alignment always holds for rgba
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, decoder.width, decoder.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		if (stats) {
+			stats->decoded += size;
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &pbo);
+	return success;
+}
+
+//the path main.cpp used before the decoder existed
+static bool uploadImageTextureSurface(const char* path, ImageCopyStats& stats)
+{
+	SDL_Surface* loaded = IMG_Load(path);
+	if (!loaded) {
+		return false;
+	}
+	stats.decoded += (size_t)loaded->pitch * loaded->h;
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA8888, 0);
+	SDL_FreeSurface(loaded);
+	if (!converted) {
+		return false;
+	}
+	stats.converted += (size_t)converted->pitch * converted->h;
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, converted->w, converted->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, converted->pixels);
+	stats.uploaded += (size_t)converted->pitch * converted->h;
+	SDL_FreeSurface(converted);
+	return true;
+}
+
+static void printCopyStats(const char* name, const ImageCopyStats& stats, double ms)
+{
+	size_t total = stats.decoded + stats.converted + stats.uploaded;
+	std::cout << "  " << name << ": decoded " << stats.decoded << " B, converted " << stats.converted
+		<< " B, uploaded from client memory " << stats.uploaded << " B, total " << total << " B ("
+		<< ms << " ms)" << std::endl;
+}
+
+void benchmarkImageUpload(const char* path)
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	ImageCopyStats before, after;
+	Uint64 start = SDL_GetPerformanceCounter();
+	bool oldOk = uploadImageTextureSurface(path, before);
+	glFinish();
+	Uint64 middle = SDL_GetPerformanceCounter();
+	bool newOk = uploadImageTexture(path, NULL, NULL, &after);
+	glFinish();
+	Uint64 end = SDL_GetPerformanceCounter();
+
+	double frequency = (double)SDL_GetPerformanceFrequency();
+	std::cout << "bytes copied for " << path << std::endl;
+	if (oldOk) {
+		printCopyStats("before (surface convert)", before, (middle - start) * 1000.0 / frequency);
+	}
+	if (newOk) {
+		printCopyStats("after (decode into pbo)", after, (end - middle) * 1000.0 / frequency);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDeleteTextures(1, &texture);
+}
@@ -0,0 +1,58 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+struct SDL_Surface;
+
+//decodes an image file straight into the layout GL_RGBA/GL_UNSIGNED_BYTE expects
+//(r,g,b,a bytes per pixel, top row first, like the old SDL surface upload)
+//pngs go through libpng row by row, anything else falls back to SDL_image
+class ImageDecoder
+{
+public:
+	int width = 0;
+	int height = 0;
+
+	ImageDecoder();
+	~ImageDecoder();
+	ImageDecoder(const ImageDecoder&) = delete;
+	ImageDecoder& operator=(const ImageDecoder&) = delete;
+
+	//reads the header so the caller knows how big the destination has to be
+	bool open(const char* path);
+	//bytes needed for a tightly packed rgba image
+	size_t size() const;
+	//writes the pixels into dst (e.g. a mapped pixel unpack buffer), stride is bytes per row
+	bool decode(void* dst, size_t stride);
+	//interlaced pngs merge their passes by reading rows back out of dst, so it mustn't be write-only memory
+	//(a mapped buffer) for those
+	bool readsBack() const;
+
+private:
+	struct PngState;
+	PngState* png = nullptr;
+	SDL_Surface* surface = nullptr;
+
+	void close();
+};
+
+//counts every byte the cpu moves on the way from file to texture
+struct ImageCopyStats
+{
+	size_t decoded = 0;   // bytes written by the decoder
+	size_t converted = 0; // bytes written by format conversions
+	size_t uploaded = 0;  // bytes handed to gl from client memory (the driver copies these)
+};
+
+//decodes into a mapped PBO and uploads it as level 0 of the bound GL_TEXTURE_2D
+//(interlaced pngs are decoded into client memory and uploaded from there)
+bool uploadImageTexture(const char* path, int* width = NULL, int* height = NULL, ImageCopyStats* stats = NULL);
+
+//loads the texture the old way (IMG_Load -> SDL_ConvertSurfaceFormat -> glTexImage2D) and the new way
+//and prints the bytes copied per texture for both
+void benchmarkImageUpload(const char* path);
+
+#endif // !IMAGE_H
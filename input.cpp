@@ -0,0 +1,219 @@
+#include "input.h"
+
+#include <cstring>
+#include <iostream>
+
+static const char inputMagic[4] = {'I', 'N', 'P', 'T'};
+static const Uint32 inputVersion = 1;
+
+InputSession::InputSession()
+{
+	memset(playbackKeys, 0, sizeof(playbackKeys));
+}
+
+InputSession::~InputSession()
+{
+	close();
+}
+
+bool InputSession::record(const char* path)
+{
+	close();
+	file = fopen(path, "wb");
+	if (!file) {
+		std::cout << "ERROR::INPUT::COULD_NOT_WRITE " << path << std::endl;
+		return false;
+	}
+	playback = false;
+	fwrite(inputMagic, 1, 4, file);
+	fwrite(&inputVersion, sizeof(inputVersion), 1, file);
+	return true;
+}
+
+bool InputSession::play(const char* path)
+{
+	close();
+	file = fopen(path, "rb");
+	if (!file) {
+		std::cout << "ERROR::INPUT::FILE_NOT_FOUND " << path << std::endl;
+		return false;
+	}
+	char magic[4];
+	Uint32 version = 0;
+	if (fread(magic, 1, 4, file) != 4 || memcmp(magic, inputMagic, 4) != 0 || fread(&version, sizeof(version), 1, file) != 1
+		|| version != inputVersion) {
+		std::cout << "ERROR::INPUT::NOT_AN_INPUT_LOG " << path << std::endl;
+		fclose(file);
+		file = NULL;
+		return false;
+	}
+	playback = true;
+	done = false;
+	return true;
+}
+
+void InputSession::close()
+{
+	if (!file) {
+		return;
+	}
+	if (recording() && inFrame) {
+		writeFrame();
+	}
+	fclose(file);
+	file = NULL;
+	inFrame = false;
+}
+
+void InputSession::writeFrame()
+{
+	Uint16 keyCount = (Uint16)keys.size();
+	Uint16 eventCount = (Uint16)events.size();
+	fwrite(&frameClock, sizeof(frameClock), 1, file);
+	fwrite(&keyCount, sizeof(keyCount), 1, file);
+	fwrite(keys.data(), sizeof(Uint16), keyCount, file);
+	fwrite(&eventCount, sizeof(eventCount), 1, file);
+	fwrite(events.data(), sizeof(RecordedEvent), eventCount, file);
+}
+
+bool InputSession::readFrame()
+{
+	Uint16 keyCount = 0, eventCount = 0;
+	if (fread(&frameClock, sizeof(frameClock), 1, file) != 1 || fread(&keyCount, sizeof(keyCount), 1, file) != 1) {
+		return false;
+	}
+	keys.resize(keyCount);
+	if (fread(keys.data(), sizeof(Uint16), keyCount, file) != keyCount || fread(&eventCount, sizeof(eventCount), 1, file) != 1) {
+		return false;
+	}
+	events.resize(eventCount);
+	if (fread(events.data(), sizeof(RecordedEvent), eventCount, file) != eventCount) {
+		return false;
+	}
+	memset(playbackKeys, 0, sizeof(playbackKeys));
+	for (Uint16 key : keys) {
+		if (key < SDL_NUM_SCANCODES) {
+			playbackKeys[key] = 1;
+		}
+	}
+	nextEvent = 0;
+	return true;
+}
+
+double InputSession::beginFrame(double clock)
+{
+	if (playing()) {
+		if (done || !readFrame()) {
+			//nothing held down & no more events once the log ends
+			done = true;
+			memset(playbackKeys, 0, sizeof(playbackKeys));
+			events.clear();
+			nextEvent = 0;
+			return clock;
+		}
+		return frameClock;
+	}
+	if (recording()) {
+		if (inFrame) {
+			writeFrame();
+		}
+		keys.clear();
+		events.clear();
+		inFrame = true;
+	}
+	frameClock = clock;
+	keysRead = false;
+	return clock;
+}
+
+const Uint8* InputSession::keyboard()
+{
+	if (playing()) {
+		return playbackKeys;
+	}
+	const Uint8* state = SDL_GetKeyboardState(NULL);
+	if (recording() && !keysRead) {
+		for (int i = 0; i < SDL_NUM_SCANCODES; i++) {
+			if (state[i]) {
+				keys.push_back((Uint16)i);
+			}
+		}
+	}
+	keysRead = true;
+	return state;
+}
+
+bool InputSession::pollEvent(SDL_Event* event)
+{
+	if (playing()) {
+		//closing & resizing the window still work (window events aren't in the log), everything else comes from it
+		while (SDL_PollEvent(event)) {
+			if (event->type == SDL_QUIT || event->type == SDL_WINDOWEVENT) {
+				return true;
+			}
+		}
+		if (nextEvent >= events.size()) {
+			return false;
+		}
+		const RecordedEvent& recorded = events[nextEvent++];
+		memset(event, 0, sizeof(*event));
+		event->type = recorded.type;
+		switch (recorded.type) {
+		case SDL_MOUSEMOTION:
+			event->motion.x = recorded.values[0];
+			event->motion.y = recorded.values[1];
+			event->motion.xrel = recorded.values[2];
+			event->motion.yrel = recorded.values[3];
+			break;
+		case SDL_MOUSEWHEEL:
+			event->wheel.x = recorded.values[0];
+			event->wheel.y = recorded.values[1];
+			break;
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			event->key.keysym.scancode = (SDL_Scancode)recorded.values[0];
+			event->key.repeat = (Uint8)recorded.values[1];
+			break;
+		}
+		return true;
+	}
+
+	if (!SDL_PollEvent(event)) {
+		return false;
+	}
+	if (recording()) {
+		RecordedEvent recorded = {event->type, {0, 0, 0, 0}};
+		switch (event->type) {
+		case SDL_MOUSEMOTION:
+			recorded.values[0] = event->motion.x;
+			recorded.values[1] = event->motion.y;
+			recorded.values[2] = event->motion.xrel;
+			recorded.values[3] = event->motion.yrel;
+			break;
+		case SDL_MOUSEWHEEL:
+			recorded.values[0] = event->wheel.x;
+			recorded.values[1] = event->wheel.y;
+			break;
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			recorded.values[0] = event->key.keysym.scancode;
+			recorded.values[1] = event->key.repeat;
+			break;
+		case SDL_QUIT:
+			break;
+		default:
+			//window events etc. depend on the desktop, not the user
+			return true;
+		}
+		events.push_back(recorded);
+	}
+	return true;
+}
+
+bool InputSession::waitEvent(int timeoutMs)
+{
+	if (playing()) {
+		return false;
+	}
+	return SDL_WaitEventTimeout(NULL, timeoutMs) != 0;
+}
@@ -0,0 +1,61 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SDL2/SDL.h>
+
+#include <cstdio>
+#include <vector>
+
+//where processInput and the event loop get their input from: live from SDL, live while logging it to a file,
+//or played back from such a file so the same session can be run again (e.g. on another build)
+//a log holds per frame the frame clock, the keys held down and the mouse/wheel/key/quit events
+class InputSession
+{
+public:
+	InputSession();
+	~InputSession();
+	InputSession(const InputSession&) = delete;
+	InputSession& operator=(const InputSession&) = delete;
+
+	bool record(const char* path);
+	bool play(const char* path);
+	bool recording() const { return file && !playback; }
+	bool playing() const { return file && playback; }
+	//playback ran out of frames
+	bool finished() const { return done; }
+	void close();
+
+	//starts a frame, clock is the live frame time in seconds and the result the one the frame should use
+	//(the recorded one when playing back, so deltaTime comes out exactly as it did)
+	double beginFrame(double clock);
+	//SDL_GetKeyboardState for this frame
+	const Uint8* keyboard();
+	//SDL_PollEvent for this frame
+	bool pollEvent(SDL_Event* event);
+	//SDL_WaitEventTimeout without taking the event, true if one is waiting
+	//playing back it returns at once, the log already says when frames happened
+	bool waitEvent(int timeoutMs);
+
+private:
+	struct RecordedEvent
+	{
+		Uint32 type;
+		Sint32 values[4];
+	};
+
+	FILE* file = NULL;
+	bool playback = false;
+	bool done = false;
+	bool inFrame = false;
+	bool keysRead = false;
+	double frameClock = 0.0;
+	std::vector<Uint16> keys;
+	std::vector<RecordedEvent> events;
+	size_t nextEvent = 0;
+	Uint8 playbackKeys[SDL_NUM_SCANCODES];
+
+	void writeFrame();
+	bool readFrame();
+};
+
+#endif // !INPUT_H
@@ -0,0 +1,260 @@
+#include "loader.h"
+#include "context.h"
+#include "cpuprofile.h"
+#include "hash.h"
+#include "mipmap.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <iostream>
+
+ResourceLoader::~ResourceLoader()
+{
+	stop();
+}
+
+bool ResourceLoader::start(RenderContext& renderContext)
+{
+	if (running()) {
+		return true;
+	}
+	if (!renderContext.createSharedContext()) {
+		return false;
+	}
+	context = &renderContext;
+	stopping = false;
+	contextState = 0;
+	thread = std::thread(&ResourceLoader::work, this);
+	//a context that can't be made current on the thread is no use, better to find out now than per job
+	std::unique_lock<std::mutex> lock(mutex);
+	started.wait(lock, [this] { return contextState != 0; });
+	if (contextState < 0) {
+		lock.unlock();
+		thread.join();
+		context->destroySharedContext();
+		context = nullptr;
+		std::cout << "ERROR::LOADER::SHARED_CONTEXT_NOT_CURRENT" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void ResourceLoader::stop()
+{
+	if (!running()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		counts.discarded += queued.size();
+		queued.clear();
+	}
+	wake.notify_one();
+	thread.join();
+	//whatever nobody took, the objects are shared so the render context can delete them
+	for (Job& job : fenced) {
+		glDeleteSync(job.fence);
+		deleteResult(job);
+	}
+	for (Job& job : finished) {
+		deleteResult(job);
+	}
+	fenced.clear();
+	finished.clear();
+	discarded.clear();
+	outstanding = 0;
+	context->destroySharedContext();
+	context = nullptr;
+}
+
+LoadTicket ResourceLoader::submit(Job& job)
+{
+	job.result.ticket = nextTicket++;
+	job.asked = std::chrono::steady_clock::now();
+	outstanding++;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queued.push_back(std::move(job));
+	}
+	wake.notify_one();
+	return nextTicket - 1;
+}
+
+LoadTicket ResourceLoader::loadTexture(const std::string& path, int firstLevel)
+{
+	Job job;
+	job.result.kind = LoadKind::Texture;
+	job.result.firstLevel = firstLevel;
+	job.path = path;
+	return submit(job);
+}
+
+LoadTicket ResourceLoader::compileProgram(const std::string& vertexPath, const std::string& fragmentPath)
+{
+	Job job;
+	job.result.kind = LoadKind::Program;
+	job.path = vertexPath;
+	job.fragmentPath = fragmentPath;
+	return submit(job);
+}
+
+void ResourceLoader::discard(LoadTicket ticket)
+{
+	for (size_t i = 0; i < finished.size(); i++) {
+		if (finished[i].result.ticket == ticket) {
+			deleteResult(finished[i]);
+			finished.erase(finished.begin() + i);
+			outstanding--;
+			counts.discarded++;
+			return;
+		}
+	}
+	//still on the thread, update() deletes it when it comes through
+	discarded.push_back(ticket);
+}
+
+void ResourceLoader::deleteResult(Job& job)
+{
+	if (job.result.object == 0) {
+		return;
+	}
+	if (job.result.kind == LoadKind::Texture) {
+		glDeleteTextures(1, &job.result.object);
+	}
+	else {
+		glDeleteProgram(job.result.object);
+	}
+	job.result.object = 0;
+}
+
+void ResourceLoader::update()
+{
+	if (!running()) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	//fences of one context signal in order, the first one that hasn't means none after it has either
+	size_t done = 0;
+	while (done < fenced.size()) {
+		GLenum status = glClientWaitSync(fenced[done].fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		done++;
+	}
+	for (size_t i = 0; i < done; i++) {
+		Job& job = fenced[i];
+		glDeleteSync(job.fence);
+		job.fence = nullptr;
+		auto unwanted = std::find(discarded.begin(), discarded.end(), job.result.ticket);
+		if (unwanted != discarded.end()) {
+			deleteResult(job);
+			discarded.erase(unwanted);
+			outstanding--;
+			counts.discarded++;
+			continue;
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.asked).count();
+		counts.totalMs += ms;
+		counts.worstMs = std::max(counts.worstMs, ms);
+		if (job.result.object == 0) {
+			counts.failed++;
+		}
+		else if (job.result.kind == LoadKind::Texture) {
+			counts.textures++;
+		}
+		else {
+			counts.programs++;
+		}
+		finished.push_back(std::move(job));
+	}
+	fenced.erase(fenced.begin(), fenced.begin() + done);
+}
+
+bool ResourceLoader::take(LoadTicket ticket, LoadedResource& result)
+{
+	for (size_t i = 0; i < finished.size(); i++) {
+		if (finished[i].result.ticket == ticket) {
+			result = finished[i].result;
+			finished.erase(finished.begin() + i);
+			outstanding--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ResourceLoader::work()
+{
+	setCpuProfileThreadName("loader");
+	bool current = context->makeSharedCurrent();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		contextState = current ? 1 : -1;
+	}
+	started.notify_one();
+	if (!current) {
+		return;
+	}
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !queued.empty(); });
+			if (stopping) {
+				break;
+			}
+			job = std::move(queued.front());
+			queued.erase(queued.begin());
+		}
+		run(job);
+		//flushed so the fence (and everything before it) reaches the gpu without anyone waiting on it here
+		job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		std::lock_guard<std::mutex> lock(mutex);
+		fenced.push_back(std::move(job));
+	}
+	context->releaseSharedCurrent();
+}
+
+void ResourceLoader::run(Job& job)
+{
+	LoadedResource& result = job.result;
+	if (result.kind == LoadKind::Texture) {
+		CPU_ZONE("load texture");
+		MipChain chain;
+		if (!loadMipmappedChain(job.path.c_str(), chain)) {
+			std::cout << "Failed to load texture " << job.path << std::endl;
+			return;
+		}
+		result.width = chain.levels[0].width;
+		result.height = chain.levels[0].height;
+		result.levels = chain.levels.size();
+		result.firstLevel = std::clamp(result.firstLevel, 0, result.levels - 1);
+		result.hash = hashFile(job.path.c_str());
+		glGenTextures(1, &result.object);
+		glBindTexture(GL_TEXTURE_2D, result.object);
+		uploadMipChain(chain, result.firstLevel);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return;
+	}
+	CPU_ZONE("compile program");
+	Shader shader(job.path.c_str(), job.fragmentPath.c_str());
+	//Shader prints what went wrong, a broken program isn't worth handing out
+	int linked = 0;
+	glGetProgramiv(shader.ID, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		glDeleteProgram(shader.ID);
+		return;
+	}
+	result.object = shader.ID;
+}
+
+void ResourceLoader::printStats() const
+{
+	int published = counts.textures + counts.programs + counts.failed;
+	std::cout << "loader: " << counts.textures << " textures, " << counts.programs << " programs, " << counts.failed << " failed, "
+		<< counts.discarded << " discarded, " << (published ? counts.totalMs / published : 0.0) << " ms average from request to use, "
+		<< counts.worstMs << " ms worst" << std::endl;
+}
@@ -0,0 +1,120 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class RenderContext;
+
+//names a job given to the loader, 0 is never handed out
+typedef uint32_t LoadTicket;
+
+enum class LoadKind
+{
+	Texture,
+	Program
+};
+
+//what a finished job made, the object belongs to whoever takes it
+struct LoadedResource
+{
+	LoadTicket ticket = 0;
+	LoadKind kind = LoadKind::Texture;
+	//the texture or program, 0 if loading or compiling failed
+	unsigned int object = 0;
+	//textures: the size of the whole chain (levels before firstLevel included), and the asset's content hash
+	int width = 0;
+	int height = 0;
+	int levels = 0;
+	int firstLevel = 0;
+	uint64_t hash = 0;
+};
+
+struct LoaderStats
+{
+	int textures = 0;
+	int programs = 0;
+	int failed = 0;
+	int discarded = 0;
+	//from asking to the result being usable on the render thread
+	double totalMs = 0.0;
+	double worstMs = 0.0;
+};
+
+//creates textures & programs on a thread of its own, with a gl context sharing objects with the render context,
+//so decoding, uploading & compiling never hold up a frame
+//each job ends in a fence, and its result is only handed to the render thread once update() sees the fence
+//signalled (the gpu has the object complete by then), update() never waits on one
+class ResourceLoader
+{
+public:
+	ResourceLoader() = default;
+	~ResourceLoader();
+	ResourceLoader(const ResourceLoader&) = delete;
+	ResourceLoader& operator=(const ResourceLoader&) = delete;
+
+	//makes the shared context & starts the thread, false (and the caller loads on its own) if the context can't be made
+	bool start(RenderContext& context);
+	//drops what's still queued, deletes what was never taken & the shared context
+	void stop();
+	bool running() const { return thread.joinable(); }
+
+	//the asset's mip chain from firstLevel down, from the mip cache like TextureManager's own loads
+	LoadTicket loadTexture(const std::string& path, int firstLevel = 0);
+	LoadTicket compileProgram(const std::string& vertexPath, const std::string& fragmentPath);
+	//the result gets deleted instead of handed out (the asker doesn't want it any more)
+	void discard(LoadTicket ticket);
+
+	//on the render thread once a frame: moves jobs whose fence signalled to the finished ones
+	void update();
+	//a finished job's result (taken once), false while it's still going
+	bool take(LoadTicket ticket, LoadedResource& result);
+	//jobs not taken yet, and how many of them are finished
+	int pending() const { return outstanding; }
+	int ready() const { return finished.size(); }
+
+	const LoaderStats& stats() const { return counts; }
+	void printStats() const;
+
+private:
+	struct Job
+	{
+		LoadedResource result;
+		std::string path;
+		std::string fragmentPath;
+		GLsync fence = nullptr;
+		std::chrono::steady_clock::time_point asked;
+	};
+
+	RenderContext* context = nullptr;
+	LoadTicket nextTicket = 1;
+	int outstanding = 0;
+	LoaderStats counts;
+
+	//queued & fenced are shared with the thread, the rest is the render thread's
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable started;
+	std::vector<Job> queued;
+	std::vector<Job> fenced;
+	bool stopping = false;
+	//set by the thread once it knows whether its context is current
+	int contextState = 0;
+	std::vector<Job> finished;
+	std::vector<LoadTicket> discarded;
+
+	LoadTicket submit(Job& job);
+	void work();
+	void run(Job& job);
+	void deleteResult(Job& job);
+};
+
+#endif // !LOADER_H
@@ -6,24 +6,62 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "shader.h"
+#include "image.h"
+#include "mipmap.h"
+#include "sampler.h"
+#include "bake.h"
+#include "texman.h"
+#include "context.h"
+#include "texture.h"
+#include "bench.h"
+#include "gpuprofile.h"
+#include "cpuprofile.h"
+#include "glcapture.h"
+#include "input.h"
+#include "renderstats.h"
+#include "framecapture.h"
+#include "loader.h"
+#include "tasks.h"
+#include "assetload.h"
+#include "perfcounters.h"
+#include "metrics.h"
+#include "simclock.h"
+#include "redraw.h"
+#include "dynres.h"
+#include "postprocess.h"
+#include "rendergraph.h"
+#include "depthorder.h"
+#include "arena.h"
+#include "alloccount.h"
 #include <filesystem>
 #include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <vector>
 
 
 //functions used later in the program for, framebuffer & getting input
 void framebuffer_size_callback(SDL_Window *window, int width, int height);
 void processInput(SDL_Window *window);
+void simulateStep(double step);
 //sets up the mouse
 void mouse_callback(SDL_Window *window, double xpos, double ypos);
 void scroll_callback(SDL_Window *window, double xoffset, double yoffset);
+//renders a screen full of far away cubes with the old and new samplers and prints the fragment rate
+void benchmarkDistantCubes(Shader &shader, const SamplerLibrary &samplers);
+//where cube i of the scene goes, the first ten are the hand placed ones
+glm::vec3 cubePosition(unsigned int i);
 
 //icon image
-SDL_Surface *iconImage;
 
 //Path to all relevant files
 std::filesystem::path currentPath = std::filesystem::current_path();
 std::filesystem::path vertexPath;
 std::filesystem::path fragPath;
+std::filesystem::path bakedFragPath;
 std::filesystem::path iconPath;
 std::filesystem::path tex1Path;
 std::filesystem::path tex2Path;
@@ -46,10 +84,16 @@ float changeInCameraSpeed = 0.0f;
 
 //setting the inital mouse position
 float lastX = SCR_WIDTH/2, lastY = SCR_HEIGHT/2;
+//the window's (or headless target's) size in pixels, follows resizes
+int outputWidth = SCR_WIDTH, outputHeight = SCR_HEIGHT;
+//the scene at a lower resolution, upscaled to the window (only with --dynamic-resolution or --render-scale)
+DynamicResolution dynamicResolution;
+//full screen effects between the scene & the window (only with --post)
+PostProcessChain postProcess;
 
-//deltatime & lastframe variables
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
+//the fixed step clock camera movement & animation run on, and the frame clock of the last frame
+SimulationClock simulation;
+double lastFrame = 0.0;
 
 //direction for the rotation
 float yaw = -90.0f;
@@ -137,70 +181,323 @@ glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 }; */
 
 // time warp
-float extraTime = 0.0f;
+double extraTime = 0.0;
+//how fast the cubes animate, 0 pauses them (P toggles)
+double timeScale = 1.0;
 
 // if the window should close... NOW!
 bool closed;
 
+//live input, or input being logged / played back
+InputSession input;
+
 //Prepares the paths
 void preparePath() {
     // shouldn't these paths be inlined into main?
     // (i changed them from string to std::filesystem::path and moved the additional paths to here)
     vertexPath = currentPath / "shaders/shader.vs";
     fragPath = currentPath / "shaders/shader.fs";
+    bakedFragPath = currentPath / "shaders/baked.fs";
     tex1Path = currentPath / "assets/milly.png";
     tex2Path = currentPath / "assets/boba.png";
     iconPath = currentPath / "assets/icon.png";
     std::cout << currentPath << vertexPath.c_str() << tex2Path.c_str() << '\n';
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    //command line flags
+    bool benchUpload = false;
+    bool benchMips = false;
+    bool benchSamplers = false;
+    bool bake = true;
+    size_t textureBudget = 256 * 1024 * 1024;
+    bool headless = false;
+    int maxFrames = 0;
+    const char *benchPath = NULL;
+    const char *benchOut = "bench.json";
+    const char *gpuProfileOut = NULL;
+    const char *cpuTraceOut = "cpu-trace.json";
+    bool cpuTrace = false;
+    bool benchZones = false;
+    bool printStats = false;
+    bool perfFlag = false;
+    const char *metricsSocket = NULL;
+    //2 leaves the swap interval at the driver's default
+    int swapInterval = 2;
+    int frameQueue = -1;
+    int maxFps = 0;
+    bool onDemand = false;
+    double resolutionBudget = 0.0;
+    double renderScale = 0.0;
+    double minRenderScale = 0.5;
+    std::vector<std::string> postEffects;
+    std::vector<std::string> postParams;
+    bool fusePost = true;
+    bool aliasTargets = true;
+    DepthMode depthMode = DepthMode::Unsorted;
+    bool checkAllocations = false;
+    bool overdrawView = false;
+    bool syncLoads = false;
+    const char *framesDir = NULL;
+    FrameFormat framesFormat = FrameFormat::Png;
+    const char *capturePath = NULL;
+    const char *recordInputPath = NULL;
+    const char *playInputPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench-upload") {
+            benchUpload = true;
+        }
+        else if (arg == "--bench-mips") {
+            benchMips = true;
+        }
+        else if (arg == "--bench-samplers") {
+            benchSamplers = true;
+        }
+        else if (arg == "--no-bake") {
+            bake = false;
+        }
+        else if (arg == "--sync-loads") {
+            //no loader thread, texture streaming & shader reloads (F5) happen in the frame that asks for them
+            syncLoads = true;
+        }
+        else if (arg == "--texture-budget" && i + 1 < argc) {
+            //in MiB
+            textureBudget = (size_t)std::atoi(argv[++i]) * 1024 * 1024;
+        }
+        else if (arg == "--headless") {
+            headless = true;
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            maxFrames = std::atoi(argv[++i]);
+        }
+        else if (arg == "--bench" && i + 1 < argc) {
+            //a scripted camera path, see benchmarks/*.bench
+            benchPath = argv[++i];
+        }
+        else if (arg == "--bench-out" && i + 1 < argc) {
+            benchOut = argv[++i];
+        }
+        else if (arg == "--cpu-trace" && i + 1 < argc) {
+            //records cpu zones from the start, F9 toggles recording at runtime either way
+            cpuTraceOut = argv[++i];
+            cpuTrace = true;
+        }
+        else if (arg == "--capture" && i + 1 < argc) {
+            //records every gl call into the file for glreplay
+            capturePath = argv[++i];
+        }
+        else if (arg == "--record-input" && i + 1 < argc) {
+            recordInputPath = argv[++i];
+        }
+        else if (arg == "--play-input" && i + 1 < argc) {
+            //runs a recorded session again, quits when it ends
+            playInputPath = argv[++i];
+        }
+        else if (arg == "--bench-zones") {
+            benchZones = true;
+        }
+        else if (arg == "--capture-frames" && i + 1 < argc) {
+            //every frame read back (without stalling) & saved into the directory, with a list of their hashes
+            framesDir = argv[++i];
+        }
+        else if (arg == "--capture-format" && i + 1 < argc) {
+            std::string name = argv[++i];
+            framesFormat = name == "raw" ? FrameFormat::Raw : name == "hash" ? FrameFormat::Hash : FrameFormat::Png;
+        }
+        else if (arg == "--swap-interval" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            swapInterval = mode == "off" ? 0 : mode == "adaptive" ? -1 : 1;
+        }
+        else if (arg == "--sim-rate" && i + 1 < argc) {
+            //fixed simulation steps per second (120 by default)
+            simulation.setRate(atof(argv[++i]));
+        }
+        else if (arg == "--max-fps" && i + 1 < argc) {
+            maxFps = atoi(argv[++i]);
+        }
+        else if (arg == "--on-demand") {
+            //only draws when the camera, the animation or the window changed, sleeps otherwise
+            onDemand = true;
+        }
+        else if (arg == "--time-scale" && i + 1 < argc) {
+            timeScale = atof(argv[++i]);
+        }
+        else if (arg == "--dynamic-resolution" && i + 1 < argc) {
+            //frame time budget in ms, the render resolution drops & recovers to stay under it
+            resolutionBudget = atof(argv[++i]);
+        }
+        else if (arg == "--render-scale" && i + 1 < argc) {
+            //the fraction of the window resolution to render at (to start from with --dynamic-resolution)
+            renderScale = atof(argv[++i]);
+        }
+        else if (arg == "--min-render-scale" && i + 1 < argc) {
+            minRenderScale = atof(argv[++i]);
+        }
+        else if (arg == "--post" && i + 1 < argc) {
+            //comma separated effects from shaders/post, in order, e.g. sharpen,tonemap,grade,vignette
+            std::string list = argv[++i];
+            for (size_t start = 0, end; start <= list.size(); start = end + 1) {
+                end = std::min(list.find(',', start), list.size());
+                if (end > start) {
+                    postEffects.push_back(list.substr(start, end - start));
+                }
+            }
+        }
+        else if (arg == "--post-param" && i + 1 < argc) {
+            //effect.param=value, e.g. tonemap.exposure=1.5
+            postParams.push_back(argv[++i]);
+        }
+        else if (arg == "--no-post-fuse") {
+            //every effect in a pass of its own, to compare against the fused chain
+            fusePost = false;
+        }
+        else if (arg == "--no-aliasing") {
+            //every transient render target gets memory of its own, to compare the graph's memory against
+            aliasTargets = false;
+        }
+        else if (arg == "--depth-mode" && i + 1 < argc) {
+            //unsorted, sorted (front to back), prepass (depth only first) or auto (picked from the measured overdraw)
+            if (!parseDepthMode(argv[++i], depthMode)) {
+                std::cout << "unknown depth mode: " << argv[i] << std::endl;
+            }
+        }
+        else if (arg == "--overdraw") {
+            //shows fragments shaded per pixel as a heat map instead of the scene (counts print with --render-stats)
+            overdrawView = true;
+        }
+        else if (arg == "--check-allocations") {
+            //fails the run (exit code 1) if any frame after the warm up allocates on the heap
+            checkAllocations = true;
+        }
+        else if (arg == "--frame-queue" && i + 1 < argc) {
+            //frames the cpu may get ahead of the gpu, 0 finishes every frame before starting the next
+            frameQueue = atoi(argv[++i]);
+        }
+        else if (arg == "--metrics-socket" && i + 1 < argc) {
+            //frame times, gpu time, memory & texture cache numbers for prometheus, served on a unix socket
+            metricsSocket = argv[++i];
+        }
+        else if (arg == "--perf-counters") {
+            //cycles, instructions, cache & branch misses of the main thread per frame, printed once a second
+            perfFlag = true;
+        }
+        else if (arg == "--render-stats") {
+            //draws, binds, uploads etc. per frame, printed once a second
+            printStats = true;
+        }
+        else if (arg == "--gpu-profile" && i + 1 < argc) {
+            //per pass gpu times, printed & written to the file on exit
+            gpuProfileOut = argv[++i];
+        }
+        else {
+            std::cout << "unknown argument: " << arg << std::endl;
+        }
+    }
+
+
     //Setting up the path
     preparePath();
 
-    SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO);
+    BenchScript benchScript;
+    if (benchPath && !benchScript.load(benchPath)) {
+        return -1;
+    }
+
+    //prints what a profiling zone costs with profiling off & on, then quits
+    if (benchZones) {
+        benchmarkCpuZones();
+        return 0;
+    }
+    setCpuProfileThreadName("main");
+    if (cpuTrace) {
+        startCpuProfiling();
+    }
+
+    //headless runs have no window, so no video subsystem either (events & keyboard state still work)
+    SDL_Init(headless ? SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_TIMER | SDL_INIT_VIDEO);
+    if ((playInputPath && !input.play(playInputPath)) || (recordInputPath && !input.record(recordInputPath))) {
+        SDL_Quit();
+        return -1;
+    }
+    if (headless && maxFrames <= 0 && !benchPath && !playInputPath) {
+        //nothing would ever close it
+        maxFrames = 600;
+    }
 
-    SDL_Window *window = SDL_CreateWindow(":3 UwU XD SillyWindow", 0, 0, SCR_WIDTH, SCR_HEIGHT, SDL_WINDOW_OPENGL);
-    SDL_GLContext gl_context = SDL_GL_CreateContext(window);
+    //makes the window (or the offscreen target) and the gl context, and loads glad
+    RenderContext context;
+    bool created = headless ? context.createHeadless(SCR_WIDTH, SCR_HEIGHT) : context.createWindow(":3 UwU XD SillyWindow", SCR_WIDTH, SCR_HEIGHT);
     long long startTick = SDL_GetPerformanceCounter();
 
-    //checks that the new window isnt null, if it is then it will terminate with an error
-    if (window == NULL)
+    //checks that the context was made, if it isnt then it will terminate with an error
+    if (!created)
     {
-        std::cout << "Failed to create window: " << SDL_GetError() << std::endl;
+        context.destroy();
         SDL_Quit();
         return -1;
     }
-
-    iconImage = IMG_Load(iconPath.c_str());
-    SDL_SetWindowIcon(window, iconImage);
-    SDL_FreeSurface(iconImage);
+    SDL_Window *window = context.window;
+    if (swapInterval != 2) {
+        context.setSwapInterval(swapInterval);
+    }
+    context.setFrameQueueLimit(frameQueue);
 
     //framebuffer variables // these are only used here, so i moved them
     int framebufferWidth;
     int framebufferHeight;
 
-    //loads in glad, sending an error if it doesnt
-    if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress))
-    {
-        std::cout << "Failed to initalize GLAD" << std::endl;
-        return -1;
+    initTextureStorage(context.loader());
+    //has to start before anything is created so the replay can build the same objects
+    if (capturePath) {
+        startGlCapture(capturePath, context.width, context.height);
     }
 
     //sets the gl viewport (normalized for -1 to 1)
-    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
     //gets the max vertex attributes attributed to each shader
     int nrAttributes;
     glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
     std::cout << "max num of vertex attributes supported: " << nrAttributes << std::endl;
 
-    //compiles the shader
-    
-    Shader ourShader(vertexPath.c_str(), fragPath.c_str());
+    //prints how many bytes each texture load copies and/or how long the mip chains take, then quits
+    if (benchUpload || benchMips) {
+        if (benchUpload) {
+            benchmarkImageUpload(tex1Path.c_str());
+            benchmarkImageUpload(tex2Path.c_str());
+        }
+        if (benchMips) {
+            benchmarkMipGeneration(tex1Path.c_str());
+            benchmarkMipGeneration(tex2Path.c_str());
+        }
+        stopGlCapture();
+        context.destroy();
+        SDL_Quit();
+        return 0;
+    }
+
+    //the assets load as tasks: files are read & decoded on worker threads while this thread uploads & compiles
+    //whatever is ready, so the icon, the textures & the shader overlap instead of loading one after the other
+    TaskScheduler scheduler;
+    //textures, owned by the manager so they get shared, evicted when over budget & streamed back
+    TextureManager textures(textureBudget);
+    TextureHandle texture1;
+    TextureHandle texture2;
+    std::optional<Shader> sceneShader;
+    if (window) {
+        scheduler.spawn(loadWindowIcon(scheduler, window, iconPath.string()));
+    }
+    //silly milly texture, the whole mip chain is generated on the cpu the first time and read from assets/*.mips after that
+    scheduler.spawn(loadTextureAsset(scheduler, textures, tex1Path.string(), texture1));
+    //texture for boba tea
+    scheduler.spawn(loadTextureAsset(scheduler, textures, tex2Path.string(), texture2));
+    //the baked variant if baking is on, swapped for the blending one below when the bake doesn't happen
+    scheduler.spawn(loadShaderAsset(scheduler, vertexPath.string(), (bake ? bakedFragPath : fragPath).string(), sceneShader));
+
+    //the geometry & samplers are only gl calls, they go while the workers decode
 
-    
     //generates a vertex attribute array
     glGenVertexArrays(1, &VAO);
     //Generates a vertex buffer, setting VBO as an id to it
@@ -217,9 +514,9 @@ int main()
 
 
     //loads the vertices data into the buffer for the gpu to use
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    bufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
     //loads indicies data into the ebo buffer for the gpu
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
     
     //sets the proper attributes for the vertex data
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
@@ -233,52 +530,60 @@ int main()
     //--glEnableVertexAttribArray(2);
 
 
-    //textures
-    unsigned int texture1, texture2;
-    //generates silly milly texture
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    int width, height, nrChannels;
-    SDL_Surface *image1 = SDL_ConvertSurfaceFormat(IMG_Load(tex1Path.c_str()), SDL_PIXELFORMAT_RGBA8888, 0);
-    if (image1) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image1->w, image1->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image1->pixels);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    //filtering & wrapping live in sampler objects, the textures only hold the mip chains
+    SamplerLibrary samplers;
+    if (!samplers.create()) {
+        std::cout << "Failed to create samplers" << std::endl;
     }
-    else {
+
+    //the rest of the loading, on this thread whenever a task hops onto it
+    scheduler.run();
+    if (!texture1.valid()) {
         std::cout << "Failed to load texture" << std::endl;
     }
-    
-    SDL_FreeSurface(image1);
-
-    //generates a texture for boba tea
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    SDL_Surface *image2 = SDL_ConvertSurfaceFormat(IMG_Load(tex2Path.c_str()), SDL_PIXELFORMAT_RGBA8888, 0);
-    if (image2) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image2->w, image2->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image2->pixels);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else {
+    if (!texture2.valid()) {
         std::cout << "Failed to load texture 2" << std::endl;
     }
-    
-    SDL_FreeSurface(image2);
 
-    //sets the texture uniforms
-    ourShader.use();
-    ourShader.setInt("texture1", 0);
-    ourShader.setInt("texture2", 1);
+    //neither texture nor the 0.2 weight ever change, so the mix is rendered once (or read from assets/baked)
+    //and the cubes only need one texture fetch
+    BlendMaterial material = {{{tex1Path.string(), textures.texture(texture1), true}, {tex2Path.string(), textures.texture(texture2), true}}, 0.2f, true};
+    unsigned int bakedTexture = 0;
+    if (bake && canBakeBlend(material)) {
+        bakedTexture = bakeBlend(material, samplers, currentPath / "shaders", currentPath / "assets/baked");
+    }
+    //the inputs aren't sampled any more once they're baked
+    if (bakedTexture) {
+        textures.release(texture1);
+        textures.release(texture2);
+    }
+
+    //the shader compiled for a bake that didn't happen
+    const std::filesystem::path &sceneFragPath = bakedTexture ? bakedFragPath : fragPath;
+    if (bake && !bakedTexture) {
+        glDeleteProgram(sceneShader->ID);
+        scheduler.spawn(loadShaderAsset(scheduler, vertexPath.string(), sceneFragPath.string(), sceneShader));
+        scheduler.run();
+    }
+    scheduler.printStages(std::cout);
+    Shader &ourShader = *sceneShader;
+
+    //sets the texture uniforms, again whenever F5 rebuilds the program
+    auto setSceneUniforms = [&]() {
+        ourShader.use();
+        if (bakedTexture) {
+            ourShader.setInt("baked", 0);
+        }
+        else {
+            ourShader.setInt("texture1", 0);
+            ourShader.setInt("texture2", 1);
+            ourShader.setFloat("blendWeight", material.weight);
+        }
+    };
+    setSceneUniforms();
 
     //Enables the Z-BUFFER
-    glEnable(GL_DEPTH_TEST);
+    enableState(GL_DEPTH_TEST);
     
     // these look like one off kind of things (surely you don't have to reregister the callbacks every frame right?) (moved from processInput)
     //disables visible cursor capture
@@ -288,82 +593,266 @@ int main()
     //SDL_ShowCursor(SDL_ENABLE);
 
     //sets & binds each of the textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-  
-    closed=false;
-
-    //the render loop
-    while (!closed)
-    {
-        //swaps the rendered buffer with the next image render buffer
-        SDL_GL_SwapWindow(window);
-        //a function to handle input
-        processInput(window);
-        //rendering commands
-        //sets the back color of the toberendered buffer to the rgba values
-        glClearColor(0.4f, 0.3f, 0.5f, 1.0f);
-        //clears it to the the color buffer (i.e. the clear color setting) & uses the z-buffer
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        //gets the deltaTime using differing times & frames
-        float currentFrame = ((double)(SDL_GetPerformanceCounter() - startTick)) / ((double)SDL_GetPerformanceFrequency());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        //uses the program
-        ourShader.use();
-
-
-        //Base mat4 coordinate transformations
-        glm::mat4 view;
-        glm::mat4 projection;
-
-        view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-
-        //sets the value for each mat4 transformation in coordinate spaces
-        projection = glm::perspective(glm::radians(fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-        //std::cout << "SDL_GetPerformanceCounter() << " " << startTick" << std::endl;
-        //std::cout << SDL_GetPerformanceCounter() << " " << startTick << std::endl;
-        //std::cout << SDL_GetPerformanceCounter() - startTick << " " << SDL_GetPerformanceFrequency() << std::endl;
-        //std::cout << (double)(SDL_GetPerformanceCounter() - startTick) << " " << (double)SDL_GetPerformanceFrequency() << std::endl;
-        //std::cout << ((double)(SDL_GetPerformanceCounter() - startTick)) / ((double)SDL_GetPerformanceFrequency()) << std::endl;
-        //std::cout << ((double)(SDL_GetPerformanceCounter() - startTick)) / ((double)SDL_GetPerformanceFrequency()) + extraTime << std::endl;
-        //std::cout << (float)(((double)(SDL_GetPerformanceCounter() - startTick)) / ((double)SDL_GetPerformanceFrequency()) + extraTime) << std::endl;
-        
-        //model render loop
-        for (unsigned int i = 0; i < 10; i++) {
-
-            glm::mat4 model = glm::mat4(1.0f);
+    if (bakedTexture) {
+        activeTexture(GL_TEXTURE0);
+        bindTexture(GL_TEXTURE_2D, bakedTexture);
+        samplers.bind(0, "trilinear_clamp");
+    }
+    else {
+        textures.bind(0, texture1);
+        textures.bind(1, texture2);
+        samplers.bind(0, "trilinear_mirror");
+        samplers.bind(1, "trilinear_clamp");
+    }
 
-            float amountRotatedAngle = -10.0f * i;
-            float deltaRotatedAngle = 50.0f + (i * 50);
+    if (resolutionBudget > 0.0 || renderScale > 0.0) {
+        dynamicResolution.setScaleRange(minRenderScale, 1.0);
+        dynamicResolution.setScale(renderScale > 0.0 ? renderScale : 1.0);
+        dynamicResolution.setBudget(resolutionBudget);
+        dynamicResolution.create(currentPath / "shaders", outputWidth, outputHeight);
+    }
 
+    if (!postEffects.empty()) {
+        if (postProcess.create(currentPath / "shaders", postEffects, fusePost, outputWidth, outputHeight)) {
+            for (const std::string &param : postParams) {
+                size_t dot = param.find('.');
+                size_t equals = param.find('=');
+                if (dot == std::string::npos || equals == std::string::npos || equals < dot ||
+                    !postProcess.setParam(param.substr(0, dot), param.substr(dot + 1, equals - dot - 1), (float)atof(param.c_str() + equals + 1))) {
+                    std::cout << "ERROR::POSTPROCESS::UNKNOWN_PARAM " << param << std::endl;
+                }
+            }
+            postProcess.printPlan(std::cout);
+        }
+        else {
+            std::cout << "rendering without post processing" << std::endl;
+        }
+    }
 
-            model = glm::translate(model, cubePositions[i]);
-            model = glm::rotate(model, glm::radians(amountRotatedAngle), glm::vec3(1.0f, 0.3f, 0.5f));
+    //the cube order & depth passes, and the overdraw they leave
+    DepthOrdering depthOrdering;
+    depthOrdering.setMode(depthMode);
+    if (depthMode != DepthMode::Unsorted || overdrawView) {
+        depthOrdering.create(currentPath / "shaders");
+    }
 
+    if (benchSamplers) {
+        benchmarkDistantCubes(ourShader, samplers);
+        samplers.destroy();
+        textures.destroy();
+        stopGlCapture();
+        context.destroy();
+        SDL_Quit();
+        return 0;
+    }
+  
+    //textures stream back in & shaders get rebuilt on a thread with its own (shared) context from here on,
+    //the loader's gl calls would land in a gl capture out of order, so a captured session does it all in the frame
+    ResourceLoader loader;
+    if (!syncLoads && !capturePath && loader.start(context)) {
+        textures.setLoader(&loader);
+    }
+    //the rebuilt scene program the loader is working on
+    LoadTicket sceneProgramTicket = 0;
+    bool reloadAssets = false;
 
-            //rotates the local space by 50 rads over time
-            model = glm::rotate(model, (float)(((double)(SDL_GetPerformanceCounter() - startTick)) / ((double)SDL_GetPerformanceFrequency()) + extraTime) * glm::radians(deltaRotatedAngle), glm::vec3(0.5f, 1.0f, 0.0f));
+    closed=false;
+    int frameCount = 0;
+    //the scene is the ten cubes unless a benchmark asks for more
+    unsigned int cubeCount = benchPath ? benchScript.cubes : 10;
+    //benchmarks run a fixed number of frames on simulated time and write their results at the end
+    std::unique_ptr<BenchRecorder> bench;
+    if (benchPath) {
+        bench.reset(new BenchRecorder(benchScript));
+    }
+    GpuProfiler gpuProfiler;
+    //the exported gpu frame time comes from the profiler too
+    if (gpuProfileOut || metricsSocket) {
+        gpuProfiler.enable();
+    }
 
-            ourShader.setMat4("model", model);
+    //model matrices & the camera's, rebuilt every frame
+    std::vector<glm::mat4> models(cubeCount);
+    glm::mat4 view;
+    glm::mat4 projection;
+    //the cubes with whichever program is bound, the depth passes & the overdraw count draw them too
+    //(made once, a std::function holding this many references is a heap allocation every time it's made)
+    SceneDraw drawCubes = [&](Shader &shader, const std::vector<unsigned int> &order) {
+        shader.setMat4("projection", projection);
+        shader.setMat4("view", view);
+        for (unsigned int i : order) {
+            shader.setMat4("model", models[i]);
 
             //draws vertexs from the VAO that pulls each vertex point to draw,
             //and draws each VAO as an element of a triangle
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            drawArrays(GL_TRIANGLES, 0, 36);
         }
-        //--glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    
-        SDL_Event event;
+    };
 
+    //the setup isn't part of any frame
+    resetRenderStats();
+    if (printStats && !renderStatsCompiled()) {
+        std::cout << "render stats were compiled out (NO_RENDER_STATS)" << std::endl;
+    }
+    FrameCapture frameCapture;
+    if (framesDir) {
+        frameCapture.start(framesDir, framesFormat, context.width, context.height);
+    }
+    PerfCounters perfCounters;
+    PerfSample perfLast, perfSincePrint, perfWholeRun;
+    if (perfFlag && perfCounters.open()) {
+        perfCounters.read(perfLast);
+        if (bench) {
+            bench->setPerfCounters(&perfCounters);
+        }
+    }
+    RenderStats statsSincePrint;
+    int framesSincePrint = 0;
+    long long statsPrinted = startTick;
+
+    //registered either way, only updated while the exporter runs
+    MetricsExporter metrics;
+    const std::vector<double> frameBounds = {0.004, 0.008, 0.0167, 0.0333, 0.05, 0.1, 0.25, 1.0};
+    MetricHistogram *frameTimeMetric = metrics.histogram("frame_time_seconds", "wall time between presents", frameBounds);
+    MetricHistogram *gpuTimeMetric = metrics.histogram("gpu_frame_time_seconds", "gpu time of a frame", frameBounds);
+    MetricCounter *framesMetric = metrics.counter("frames_total", "frames rendered");
+    MetricCounter *drawsMetric = metrics.counter("draw_calls_total", "draw calls");
+    MetricCounter *textureBindsMetric = metrics.counter("texture_binds_total", "texture binds");
+    MetricGauge *textureResidentMetric = metrics.gauge("texture_resident_bytes", "texture memory in use");
+    MetricGauge *textureBudgetMetric = metrics.gauge("texture_budget_bytes", "texture memory budget");
+    MetricCounter *textureLoadsMetric = metrics.counter("texture_loads_total", "textures loaded from disk");
+    MetricCounter *textureSharedMetric = metrics.counter("texture_dedup_hits_total", "loads served by an already loaded texture");
+    MetricCounter *textureReloadsMetric = metrics.counter("texture_reloads_total", "binds that had to stream an evicted texture back in");
+    MetricCounter *textureEvictionsMetric = metrics.counter("texture_evictions_total", "textures evicted to stay in budget");
+    MetricHistogram *inputLatencyMetric = metrics.histogram("input_to_submit_seconds", "time from sampling input to submitting the frame built from it",
+        {0.001, 0.002, 0.004, 0.008, 0.0167, 0.0333, 0.1});
+    //the exporter thread walks the metrics, so everything is registered before it starts
+    if (metricsSocket && metrics.start(metricsSocket)) {
+        //the first beginFrame() clears the per-frame numbers, the startup loads only get counted here
+        textureLoadsMetric->add(textures.stats().loads);
+        textureSharedMetric->add(textures.stats().dedupHits);
+    }
+    long long lastPresent = SDL_GetPerformanceCounter();
+    //the simulated state before the last step, rendering interpolates from it to the current one
+    glm::vec3 previousCameraPos = cameraPos;
+    double sceneClock = 0.0;
+    double previousSceneClock = 0.0;
+    long long lastCapped = lastPresent;
+    //the frame's passes & their transient targets, rebuilt every frame, each plan is printed the first time it shows up
+    //(auto depth mode brings the overdraw pass back every so often, that's not worth printing every time)
+    //memory for what only lives during a frame, reset once the frame is submitted
+    FrameArena frameArena;
+    RenderGraph renderGraph(frameArena);
+    renderGraph.setAliasing(aliasTargets);
+    renderGraph.setProfiler(&gpuProfiler);
+    std::vector<RenderGraphStats> graphsPrinted;
+    //the last present a frame time can be measured from, 0 after an idle turn
+    long long previousPresent = 0;
+    double animationClock = 0.0;
+    //on demand, whether the last loop turn drew a frame (and so has one to present)
+    RedrawTracker redraw;
+    bool drewFrame = true;
+    IdleStats idlePrinted;
+    long long idlePrintedAt = startTick;
+    long long inputSampled = 0;
+    double latencySincePrint = 0.0;
+    double latencyMax = 0.0;
+    int gpuFramesSeen = 0;
+    //heap allocations of frames after the warm up (pools, caches & the arena settle in the first ones)
+    const int allocationWarmup = 60;
+    uint64_t steadyAllocations = 0;
+    uint64_t steadyFrames = 0;
+    uint64_t worstFrameAllocations = 0;
+    uint64_t allocationsSincePrint = 0;
+
+    //the render loop
+    while (!closed)
+    {
+        CPU_ZONE("frame");
+        uint64_t allocationsBefore = threadAllocations();
+        long long submitted = SDL_GetPerformanceCounter();
+        //swaps the rendered buffer with the next image render buffer (when there is one, idle turns keep the old one up)
+        if (drewFrame) {
+            context.present();
+            glCaptureFrame();
+        }
+        long long presented = SDL_GetPerformanceCounter();
+        //the frame time the resolution adapts to: the gpu's when it's being profiled, otherwise present to present
+        //(which vsync pins to the refresh rate, profile the gpu to scale back up under vsync)
+        if (dynamicResolution.created() && drewFrame) {
+            GpuPassStats gpuFrame;
+            if (gpuProfiler.enabled() && gpuProfiler.pass("frame", gpuFrame)) {
+                dynamicResolution.update(gpuFrame.last);
+            }
+            else if (previousPresent) {
+                dynamicResolution.update((double)(presented - previousPresent) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+            }
+        }
+        previousPresent = drewFrame ? presented : 0;
+        if (metrics.running() && drewFrame) {
+            frameTimeMetric->record((double)(presented - lastPresent) / (double)SDL_GetPerformanceFrequency());
+            lastPresent = presented;
+        }
+        //how long the input the frame was built from waited until the frame got handed to the driver
+        if (inputSampled) {
+            double latency = (double)(submitted - inputSampled) / (double)SDL_GetPerformanceFrequency();
+            latencySincePrint += latency;
+            latencyMax = std::max(latencyMax, latency);
+            if (metrics.running()) {
+                inputLatencyMetric->record(latency);
+            }
+            if (bench) {
+                bench->recordInputLatency(latency * 1000.0);
+            }
+        }
+        if (onDemand && printStats && submitted - idlePrintedAt >= (long long)SDL_GetPerformanceFrequency()) {
+            printIdleStats(std::cout, redraw.stats() - idlePrinted, (double)(submitted - idlePrintedAt) / (double)SDL_GetPerformanceFrequency());
+            idlePrinted = redraw.stats();
+            idlePrintedAt = submitted;
+        }
+        //headless runs stop after a fixed number of frames
+        if (maxFrames > 0 && frameCount >= maxFrames) {
+            break;
+        }
+        //frames can be capped (or not), the simulation runs at its own rate either way
+        if (maxFps > 0) {
+            long long frameTicks = SDL_GetPerformanceFrequency() / maxFps;
+            long long waited = SDL_GetPerformanceCounter() - lastCapped;
+            if (waited < frameTicks) {
+                SDL_Delay((Uint32)((frameTicks - waited) * 1000 / SDL_GetPerformanceFrequency()));
+            }
+            lastCapped = SDL_GetPerformanceCounter();
+        }
+        //nothing changed last turn, sleeps until something happens
+        if (onDemand && !drewFrame) {
+            CPU_ZONE("idle");
+            redraw.wait(input);
+        }
+        //the frame clock, the recorded one when playing a session back
+        double frameClock = input.beginFrame((double)(SDL_GetPerformanceCounter() - startTick) / (double)SDL_GetPerformanceFrequency());
+        if (input.finished()) {
+            break;
+        }
+        if (bench) {
+            bench->endFrame();
+            if (bench->done()) {
+                break;
+            }
+            bench->beginFrame();
+        }
+        //how far the frame clock moved, benchmarks pretend every frame took exactly their time step
+        double frameSeconds = bench ? benchScript.timeStep : frameClock - lastFrame;
+        lastFrame = frameClock;
+
+        //input is sampled as late as possible, right before the camera gets built from it, so the mouse & keys
+        //show up in this frame instead of the next one
+        {
+        CPU_ZONE("input");
+        SDL_Event event;
         //checks if any events were triggered (i.e. input from kb&m)
-        while (SDL_PollEvent(&event)) {
+        while (input.pollEvent(&event)) {
+            //whatever the user did, the next frame should show the answer
+            redraw.markDirty(RedrawWindow);
             switch (event.type) {
               case SDL_MOUSEWHEEL:
                 scroll_callback(window, event.wheel.x, event.wheel.y);
@@ -371,68 +860,464 @@ int main()
               case SDL_MOUSEMOTION:
                 mouse_callback(window, event.motion.x, event.motion.y);
                 break;
+              case SDL_WINDOWEVENT:
+                if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                    int width, height;
+                    SDL_GL_GetDrawableSize(window, &width, &height);
+                    framebuffer_size_callback(window, width, height);
+                    context.width = width;
+                    context.height = height;
+                    frameCapture.resize(width, height);
+                }
+                break;
               case SDL_QUIT:
                 // handling of close button
                 closed = true;
                 break;
+              case SDL_KEYDOWN:
+                //F9 starts a cpu trace & the next F9 writes it
+                if (event.key.keysym.scancode == SDL_SCANCODE_F9 && !event.key.repeat) {
+                    if (cpuProfiling()) {
+                        stopCpuProfiling(cpuTraceOut);
+                    }
+                    else {
+                        startCpuProfiling();
+                    }
+                }
+                if (event.key.keysym.scancode == SDL_SCANCODE_P && !event.key.repeat) {
+                    timeScale = timeScale == 0.0 ? 1.0 : 0.0;
+                }
+                //F5 reads the scene's shaders (and unbaked textures) from disk again
+                if (event.key.keysym.scancode == SDL_SCANCODE_F5 && !event.key.repeat) {
+                    reloadAssets = true;
+                }
+                break;
               default:
                 break;
             }
         }
+        //a function to handle input (benchmarks ignore it so every run is the same)
+        if (!bench) {
+            processInput(window);
+        }
+        inputSampled = SDL_GetPerformanceCounter();
+        }
+
+        //what the loader finished since the last turn, the old program & textures stay in use until then
+        loader.update();
+        if (loader.ready() > 0) {
+            redraw.markDirty(RedrawWindow);
+        }
+        if (reloadAssets) {
+            reloadAssets = false;
+            if (loader.running()) {
+                if (sceneProgramTicket) {
+                    loader.discard(sceneProgramTicket);
+                }
+                sceneProgramTicket = loader.compileProgram(vertexPath.string(), sceneFragPath.string());
+            }
+            else {
+                Shader rebuilt(vertexPath.c_str(), sceneFragPath.c_str());
+                int linked = 0;
+                glGetProgramiv(rebuilt.ID, GL_LINK_STATUS, &linked);
+                if (linked) {
+                    glDeleteProgram(ourShader.ID);
+                    ourShader.ID = rebuilt.ID;
+                    setSceneUniforms();
+                }
+                else {
+                    glDeleteProgram(rebuilt.ID);
+                }
+            }
+            if (!bakedTexture) {
+                textures.reload(texture1);
+                textures.reload(texture2);
+            }
+        }
+        LoadedResource loaded;
+        if (sceneProgramTicket && loader.take(sceneProgramTicket, loaded)) {
+            sceneProgramTicket = 0;
+            //a program that didn't build leaves the old one drawing
+            if (loaded.object) {
+                glDeleteProgram(ourShader.ID);
+                ourShader.ID = loaded.object;
+                setSceneUniforms();
+            }
+        }
+
+        //runs the simulation steps that are due, each one remembering the state before it
+        {
+        CPU_ZONE("simulate");
+        int steps = simulation.advance(frameSeconds);
+        for (int i = 0; i < steps; i++) {
+            previousCameraPos = cameraPos;
+            previousSceneClock = sceneClock;
+            if (!bench) {
+                simulateStep(simulation.step());
+            }
+            animationClock += simulation.step() * timeScale;
+            sceneClock = animationClock + extraTime;
+        }
+        }
+        //renders between the last two steps, so motion stays smooth whatever the frame rate
+        double alpha = simulation.alpha();
+        glm::vec3 renderCameraPos = glm::mix(previousCameraPos, cameraPos, (float)alpha);
+        //what the cubes animate by
+        double sceneTime = previousSceneClock + (sceneClock - previousSceneClock) * alpha;
+        if (bench) {
+            CameraKey key = benchScript.camera((float)sceneTime);
+            renderCameraPos = key.position;
+            cameraFront = glm::normalize(glm::vec3(cos(glm::radians(key.yaw)) * cos(glm::radians(key.pitch)),
+                sin(glm::radians(key.pitch)),
+                sin(glm::radians(key.yaw)) * cos(glm::radians(key.pitch))));
+            fov = key.fov;
+        }
+
+        //on demand, nothing that shows moved: the frame on screen is still right
+        if (onDemand && !bench && redraw.check(renderCameraPos, cameraFront, fov, sceneTime, timeScale) == RedrawNone) {
+            redraw.skipped();
+            drewFrame = false;
+            inputSampled = 0;
+            continue;
+        }
+        redraw.drawn(renderCameraPos, cameraFront, fov, sceneTime, timeScale);
+        drewFrame = true;
+
+        frameCount++;
+        gpuProfiler.beginFrame();
+        textures.beginFrame();
+
+        //Base mat4 coordinate transformations
+        {
+        CPU_ZONE("matrices");
+        view = glm::lookAt(renderCameraPos, renderCameraPos + cameraFront, cameraUp);
+
+        //sets the value for each mat4 transformation in coordinate spaces
+        projection = glm::perspective(glm::radians(fov), (float)outputWidth / (float)outputHeight, 0.1f, 100.0f);
+
+        for (unsigned int i = 0; i < cubeCount; i++) {
+
+            glm::mat4 model = glm::mat4(1.0f);
+
+            float amountRotatedAngle = -10.0f * i;
+            float deltaRotatedAngle = 50.0f + (i * 50);
+
+
+            model = glm::translate(model, cubePosition(i));
+            model = glm::rotate(model, glm::radians(amountRotatedAngle), glm::vec3(1.0f, 0.3f, 0.5f));
+
+
+            //rotates the local space by 50 rads over time
+            model = glm::rotate(model, (float)sceneTime * glm::radians(deltaRotatedAngle), glm::vec3(0.5f, 1.0f, 0.0f));
+            models[i] = model;
+        }
+        }
+        depthOrdering.beginFrame(models, view, overdrawView);
+
+        //the frame's passes: the scene, then (each only when turned on) the upscale, the post effects & the readback,
+        //with the overdraw count before them when it's measured (or instead of them when it's shown)
+        RenderResource backbuffer = renderGraph.importFramebuffer("backbuffer", context.framebuffer(), outputWidth, outputHeight);
+        //straight into the window unless something runs after the scene
+        bool offscreen = dynamicResolution.created() || postProcess.created();
+        RenderResource sceneColor = backbuffer;
+        RenderResource upscaled = backbuffer;
+        //fragments shaded per pixel, counted into a target of its own with every depth mode in turn
+        RenderResource overdrawCounts = -1;
+        if (depthOrdering.measuring()) {
+            renderGraph.addPass("overdraw",
+                [&](RenderPassBuilder &pass) {
+                    overdrawCounts = pass.create("overdraw counts", {outputWidth, outputHeight, GL_RGBA8});
+                    pass.create("overdraw depth", {outputWidth, outputHeight, GL_DEPTH_COMPONENT24});
+                    //the counts are read back, and auto picks its mode from them
+                    pass.sideEffect();
+                },
+                [&](const RenderPassContext &) {
+                    depthOrdering.measure(drawCubes, outputWidth, outputHeight);
+                });
+        }
+        if (overdrawView) {
+            renderGraph.addPass("overdraw view",
+                [&](RenderPassBuilder &pass) {
+                    pass.read(overdrawCounts);
+                    pass.write(backbuffer);
+                },
+                [&](const RenderPassContext &pass) {
+                    depthOrdering.showHeat(pass.texture(overdrawCounts));
+                });
+        }
+        else {
+            renderGraph.addPass("scene",
+                [&](RenderPassBuilder &pass) {
+                    if (offscreen) {
+                        sceneColor = pass.create("scene color", {outputWidth, outputHeight, postProcess.created() ? (GLenum)GL_RGBA16F : (GLenum)GL_RGBA8});
+                        pass.create("scene depth", {outputWidth, outputHeight, GL_DEPTH_COMPONENT24});
+                    }
+                    else {
+                        pass.write(backbuffer);
+                    }
+                },
+                [&](const RenderPassContext &) {
+                    if (dynamicResolution.created()) {
+                        dynamicResolution.begin();
+                    }
+                    //rendering commands
+                    //sets the back color of the toberendered buffer to the rgba values
+                    clearColor(0.4f, 0.3f, 0.5f, 1.0f);
+                    //clears it to the the color buffer (i.e. the clear color setting) & uses the z-buffer
+                    gpuProfiler.beginPass("clear");
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    gpuProfiler.endPass();
+
+                    //rebinding every frame is what keeps the textures marked as recently used (and reloads evicted ones)
+                    if (!bakedTexture) {
+                        textures.bind(0, texture1);
+                        textures.bind(1, texture2);
+                    }
+
+                    CPU_ZONE("draw");
+                    //model render loop, in the order (and with the depth passes) the depth mode asks for
+                    depthOrdering.draw(ourShader, drawCubes, &gpuProfiler);
+                });
+            upscaled = sceneColor;
+            if (dynamicResolution.created()) {
+                renderGraph.addPass("upscale",
+                    [&](RenderPassBuilder &pass) {
+                        pass.read(sceneColor);
+                        if (postProcess.created()) {
+                            upscaled = pass.create("upscaled", {outputWidth, outputHeight, GL_RGBA16F});
+                        }
+                        else {
+                            pass.write(backbuffer);
+                        }
+                    },
+                    [&](const RenderPassContext &pass) {
+                        dynamicResolution.resolve(pass.texture(sceneColor));
+                    });
+            }
+            if (postProcess.created()) {
+                postProcess.addPasses(renderGraph, upscaled, backbuffer);
+            }
+        }
+        //--glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        if (frameCapture.active()) {
+            renderGraph.addPass("readback",
+                [&](RenderPassBuilder &pass) {
+                    pass.read(backbuffer);
+                    pass.sideEffect();
+                },
+                [&](const RenderPassContext &) {
+                    frameCapture.capture(context.framebuffer());
+                });
+        }
+        renderGraph.compile();
+        if (std::find(graphsPrinted.begin(), graphsPrinted.end(), renderGraph.stats()) == graphsPrinted.end()) {
+            renderGraph.print(std::cout);
+            graphsPrinted.push_back(renderGraph.stats());
+        }
+        renderGraph.execute();
+        //the graph lives in the arena, so it goes first
+        renderGraph.reset();
+        frameArena.reset();
+        textures.endFrame();
+        gpuProfiler.endFrame();
+        endRenderStatsFrame();
+        if (metrics.running()) {
+            const TextureStats &textureStats = textures.stats();
+            framesMetric->add();
+            drawsMetric->add(lastFrameRenderStats().drawCalls);
+            textureBindsMetric->add(lastFrameRenderStats().textureBinds);
+            textureResidentMetric->set((double)textureStats.residentBytes);
+            textureBudgetMetric->set((double)textureStats.budgetBytes);
+            textureLoadsMetric->add(textureStats.loads);
+            textureSharedMetric->add(textureStats.dedupHits);
+            textureReloadsMetric->add(textureStats.reloads);
+            textureEvictionsMetric->add(textureStats.evictions);
+            //only the newest frame when several came back at once, the histogram is about the typical frame
+            GpuPassStats gpuFrame;
+            if (gpuProfiler.collectedFrames() != gpuFramesSeen && gpuProfiler.pass("frame", gpuFrame)) {
+                gpuTimeMetric->record(gpuFrame.last / 1000.0);
+            }
+            gpuFramesSeen = gpuProfiler.collectedFrames();
+        }
+        PerfSample perfNow;
+        if (perfCounters.read(perfNow)) {
+            perfSincePrint += perfNow - perfLast;
+            perfWholeRun += perfNow - perfLast;
+            perfLast = perfNow;
+        }
+        if (printStats || perfCounters.opened()) {
+            statsSincePrint += lastFrameRenderStats();
+            framesSincePrint++;
+            long long now = SDL_GetPerformanceCounter();
+            if (now - statsPrinted >= (long long)SDL_GetPerformanceFrequency()) {
+                if (printStats) {
+                    printRenderStats(std::cout, statsSincePrint, framesSincePrint);
+                    if (dynamicResolution.created()) {
+                        std::cout << "render scale: " << dynamicResolution.scale() << " (" << dynamicResolution.renderWidth() << "x"
+                            << dynamicResolution.renderHeight() << "), " << dynamicResolution.changes() << " changes" << std::endl;
+                    }
+                    std::cout << "input to submit: " << latencySincePrint * 1000.0 / framesSincePrint << " ms average, "
+                        << latencyMax * 1000.0 << " ms max" << std::endl;
+                }
+                if (printStats && allocationCountingCompiled()) {
+                    std::cout << "heap: " << (double)allocationsSincePrint / framesSincePrint << " allocations per frame, frame arena "
+                        << frameArena.peak() / 1024.0 << " KiB peak of " << frameArena.capacity() / 1024 << " KiB" << std::endl;
+                }
+                if (printStats && depthOrdering.measurements() > 0) {
+                    printOverdraw(std::cout, depthOrdering);
+                }
+                if (perfCounters.opened()) {
+                    printPerfSample(std::cout, perfCounters, perfSincePrint, framesSincePrint);
+                }
+                statsSincePrint = RenderStats();
+                perfSincePrint = PerfSample();
+                latencySincePrint = 0.0;
+                latencyMax = 0.0;
+                allocationsSincePrint = 0;
+                framesSincePrint = 0;
+                statsPrinted = now;
+            }
+        }
+
+        //only frames that were drawn get here, idle turns went around already
+        uint64_t frameAllocations = threadAllocations() - allocationsBefore;
+        allocationsSincePrint += frameAllocations;
+        if (frameCount > allocationWarmup) {
+            steadyAllocations += frameAllocations;
+            steadyFrames++;
+            worstFrameAllocations = std::max(worstFrameAllocations, frameAllocations);
+        }
     
         // it triggers mouse events :(
         //SDL_WarpMouseInWindow(window, SCR_WIDTH/2, SCR_HEIGHT/2);
     }
+    double seconds = (double)(SDL_GetPerformanceCounter() - startTick) / (double)SDL_GetPerformanceFrequency();
+    std::cout << frameCount << " frames, " << seconds * 1000.0 / std::max(frameCount, 1) << " ms/frame average" << std::endl;
+    frameCapture.finish();
+    if (bench) {
+        bench->finish(benchOut);
+        bench.reset();
+    }
+    if (printStats && renderStatsCompiled()) {
+        std::cout << "whole run, per frame ";
+        printRenderStats(std::cout, totalRenderStats(), renderStatsFrames());
+    }
+    if (depthOrdering.measurements() > 0) {
+        std::cout << "last ";
+        printOverdraw(std::cout, depthOrdering);
+    }
+    if (onDemand) {
+        std::cout << "whole run ";
+        printIdleStats(std::cout, redraw.stats(), seconds);
+    }
+    bool allocationsFailed = false;
+    if ((printStats || checkAllocations) && allocationCountingCompiled()) {
+        std::cout << "heap: " << steadyAllocations << " allocations in " << steadyFrames << " frames after the first "
+            << allocationWarmup << " (" << worstFrameAllocations << " in the worst), frame arena peak "
+            << frameArena.peak() / 1024.0 << " KiB, grown " << frameArena.overflows() << " times" << std::endl;
+    }
+    if (checkAllocations) {
+        if (!allocationCountingCompiled()) {
+            std::cout << "allocation counting was compiled out (NO_ALLOCATION_COUNTING), nothing was checked" << std::endl;
+        }
+        else if (steadyFrames == 0) {
+            std::cout << "ERROR::ALLOCATIONS::NO_FRAMES_PAST_THE_WARM_UP" << std::endl;
+            allocationsFailed = true;
+        }
+        else if (steadyAllocations > 0) {
+            std::cout << "ERROR::ALLOCATIONS::STEADY_STATE_FRAMES_ALLOCATED" << std::endl;
+            allocationsFailed = true;
+        }
+    }
+    if (perfCounters.opened()) {
+        std::cout << "whole run, per frame ";
+        printPerfSample(std::cout, perfCounters, perfWholeRun, std::max(frameCount, 1));
+    }
+    if (cpuProfiling()) {
+        stopCpuProfiling(cpuTraceOut);
+    }
+    metrics.stop();
+    if (gpuProfiler.enabled()) {
+        gpuProfiler.destroy();
+    }
+    if (gpuProfileOut) {
+        gpuProfiler.print();
+        gpuProfiler.dump(gpuProfileOut);
+    }
+
     //delete the unused arrays
+    renderGraph.destroy();
+    dynamicResolution.destroy();
+    postProcess.destroy();
+    depthOrdering.destroy();
+    samplers.destroy();
+    textures.printStats();
+    textures.destroy();
+    if (loader.running()) {
+        loader.printStats();
+        loader.stop();
+    }
+    glDeleteTextures(1, &bakedTexture);
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO); // does this need to be freed?
     //glDeleteProgram(shaderProgram); // shaderProgram is never initialized
 
+    input.close();
+    stopGlCapture();
     //ends the glfw library
+    context.destroy();
     SDL_Quit();
-    return 0;
+    return allocationsFailed ? 1 : 0;
 }
 
 //takes in the input while window is active
 void processInput(SDL_Window *window) {
+    CPU_ZONE("processInput");
+    //the keys held down this frame
+    const Uint8 *keys = input.keyboard();
     //camera movement speed
-    float cameraSpeed = 2.5f * deltaTime + changeInCameraSpeed;
-    //right normalized vector
-    glm::vec3 rightDirectionVector = glm::normalize(glm::cross(cameraFront, cameraUp));
     //if esc is pressed then close the window
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_ESCAPE] == 1) {
+    if (keys[SDL_SCANCODE_ESCAPE] == 1) {
         closed = true;
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_1] == 1) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    if (keys[SDL_SCANCODE_1] == 1) {
+        polygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_2] == 1) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    if (keys[SDL_SCANCODE_2] == 1) {
+        polygonMode(GL_FRONT_AND_BACK, GL_LINE);
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_W] == 1) {
+}
+//moves the camera & warps time by the keys held down, once per fixed simulation step
+void simulateStep(double step) {
+    const Uint8 *keys = input.keyboard();
+    //camera movement speed
+    float cameraSpeed = 2.5f * (float)step + changeInCameraSpeed;
+    //right normalized vector
+    glm::vec3 rightDirectionVector = glm::normalize(glm::cross(cameraFront, cameraUp));
+    if (keys[SDL_SCANCODE_W] == 1) {
         cameraPos += cameraSpeed * cameraFront;
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_S] == 1) {
+    if (keys[SDL_SCANCODE_S] == 1) {
         cameraPos -= cameraSpeed * cameraFront;
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_A] == 1) {
+    if (keys[SDL_SCANCODE_A] == 1) {
         cameraPos -= rightDirectionVector * cameraSpeed;
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_D] == 1) {
+    if (keys[SDL_SCANCODE_D] == 1) {
         cameraPos += rightDirectionVector * cameraSpeed;
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_PAGEUP] == 1) {
+    if (keys[SDL_SCANCODE_PAGEUP] == 1) {
         changeInCameraSpeed += 0.01f;
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_PAGEDOWN] == 1) {
+    if (keys[SDL_SCANCODE_PAGEDOWN] == 1) {
         changeInCameraSpeed -= 0.01f;
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_SPACE] == 1) {
-        extraTime += 4 * deltaTime;
+    if (keys[SDL_SCANCODE_SPACE] == 1) {
+        extraTime += 4 * step;
     }
-    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_BACKSPACE] == 1) {
-        extraTime -= 6 * deltaTime;
+    if (keys[SDL_SCANCODE_BACKSPACE] == 1) {
+        extraTime -= 6 * step;
     }
 }
 //handles mouse input functionality
@@ -475,5 +1360,69 @@ void scroll_callback(SDL_Window *window, double xoffset, double yoffset) {
 }
 //sets the framebuffersize to change so the viewport adjusts
 void framebuffer_size_callback(SDL_Window *window, int width, int height) {
-    glViewport(0, 0, width, height);
+    outputWidth = width;
+    outputHeight = height;
+    viewport(0, 0, width, height);
+    //the offscreen targets follow, next frame's render graph asks for the new size
+    dynamicResolution.setOutputSize(width, height);
+    postProcess.setSize(width, height);
+}
+glm::vec3 cubePosition(unsigned int i) {
+    if (i < 10) {
+        return cubePositions[i];
+    }
+    //the rest go on shells around the hand placed ones, spread out by the golden angle
+    float n = (float)(i - 10);
+    float y = 1.0f - 2.0f * std::fmod(n * 0.618034f, 1.0f);
+    float ring = std::sqrt(1.0f - y * y);
+    float angle = n * 2.399963f;
+    float radius = 14.0f + std::fmod(n, 5.0f) * 2.0f;
+    return glm::vec3(cos(angle) * ring, y, sin(angle) * ring) * radius + glm::vec3(0.0f, 0.0f, -5.0f);
+}
+void benchmarkDistantCubes(Shader &shader, const SamplerLibrary &samplers) {
+    //a 24x24 wall of cubes far enough away that every texel is minified a lot
+    const int gridSize = 24;
+    const int frames = 100;
+    const char *presets[][2] = {
+        {"legacy_nearest", "legacy_nearest"},
+        {"trilinear_mirror", "trilinear_clamp"}
+    };
+    const char *names[] = {"before (base level, nearest)", "after (trilinear mipmaps)"};
+
+    shader.use();
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 200.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+
+    unsigned int query;
+    glGenQueries(1, &query);
+    for (int p = 0; p < 2; p++) {
+        samplers.bind(0, presets[p][0]);
+        samplers.bind(1, presets[p][1]);
+        glFinish();
+        long long start = SDL_GetPerformanceCounter();
+        glBeginQuery(GL_SAMPLES_PASSED, query);
+        for (int frame = 0; frame < frames; frame++) {
+            clearColor(0.4f, 0.3f, 0.5f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (int y = 0; y < gridSize; y++) {
+                for (int x = 0; x < gridSize; x++) {
+                    glm::mat4 model = glm::mat4(1.0f);
+                    model = glm::translate(model, glm::vec3((x - gridSize / 2 + 0.5f) * 2.5f, (y - gridSize / 2 + 0.5f) * 2.5f, -75.0f));
+                    model = glm::rotate(model, glm::radians(10.0f * (x + y)), glm::vec3(1.0f, 0.3f, 0.5f));
+                    shader.setMat4("model", model);
+                    drawArrays(GL_TRIANGLES, 0, 36);
+                }
+            }
+        }
+        glEndQuery(GL_SAMPLES_PASSED);
+        glFinish();
+        double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+        unsigned int samples = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+        std::cout << names[p] << ": " << seconds * 1000.0 / frames << " ms/frame, "
+            << samples / seconds / 1000000.0 << " Mfragments/s" << std::endl;
+    }
+    glDeleteQueries(1, &query);
 }
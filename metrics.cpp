@@ -0,0 +1,267 @@
+#include "metrics.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+MetricHistogram::MetricHistogram(double unit) : unit(unit)
+{
+	for (std::atomic<uint64_t>& count : counts) {
+		count.store(0, std::memory_order_relaxed);
+	}
+}
+
+int MetricHistogram::bucket(uint64_t units)
+{
+	if (units < (uint64_t)linearBuckets) {
+		return (int)units;
+	}
+	//the top 6 bits pick the bucket: the highest one the power of two, the 5 below it the sub-bucket
+	int magnitude = 63 - __builtin_clzll(units);
+	int index = linearBuckets + (magnitude - 6) * subBuckets + (int)(units >> (magnitude - 5)) - subBuckets;
+	return index < bucketCount ? index : bucketCount - 1;
+}
+
+uint64_t MetricHistogram::bucketLow(int index)
+{
+	if (index < linearBuckets) {
+		return index;
+	}
+	int magnitude = (index - linearBuckets) / subBuckets + 6;
+	uint64_t sub = (index - linearBuckets) % subBuckets + subBuckets;
+	return sub << (magnitude - 5);
+}
+
+uint64_t MetricHistogram::bucketHigh(int index)
+{
+	return index + 1 < bucketCount ? bucketLow(index + 1) - 1 : bucketLow(index);
+}
+
+void MetricHistogram::record(double seconds)
+{
+	uint64_t units = seconds > 0.0 ? (uint64_t)(seconds / unit + 0.5) : 0;
+	counts[bucket(units)].fetch_add(1, std::memory_order_relaxed);
+	total.fetch_add(1, std::memory_order_relaxed);
+	sumUnits.fetch_add(units, std::memory_order_relaxed);
+	uint64_t largest = maxUnits.load(std::memory_order_relaxed);
+	while (units > largest && !maxUnits.compare_exchange_weak(largest, units, std::memory_order_relaxed)) {
+	}
+}
+
+double MetricHistogram::quantile(double q) const
+{
+	uint64_t recorded = count();
+	if (recorded == 0) {
+		return 0.0;
+	}
+	uint64_t rank = (uint64_t)std::ceil(q * recorded);
+	rank = rank < 1 ? 1 : rank;
+	uint64_t seen = 0;
+	for (int i = 0; i < bucketCount; i++) {
+		seen += counts[i].load(std::memory_order_relaxed);
+		if (seen >= rank) {
+			//the middle of the bucket, but never past the largest value actually seen
+			double middle = (bucketLow(i) + bucketHigh(i)) * 0.5 * unit;
+			return std::min(middle, max());
+		}
+	}
+	return max();
+}
+
+uint64_t MetricHistogram::countBelow(double seconds) const
+{
+	uint64_t below = 0;
+	for (int i = 0; i < bucketCount && bucketHigh(i) * unit <= seconds; i++) {
+		below += counts[i].load(std::memory_order_relaxed);
+	}
+	return below;
+}
+
+static uint64_t steadyNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MetricsExporter::MetricsExporter() : startTicks(steadyNanoseconds())
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	stop();
+}
+
+MetricGauge* MetricsExporter::gauge(const char* name, const char* help)
+{
+	metrics.push_back({name, help, Gauge, std::unique_ptr<MetricGauge>(new MetricGauge), nullptr, nullptr, {}});
+	return metrics.back().gauge.get();
+}
+
+MetricCounter* MetricsExporter::counter(const char* name, const char* help)
+{
+	metrics.push_back({name, help, Counter, nullptr, std::unique_ptr<MetricCounter>(new MetricCounter), nullptr, {}});
+	return metrics.back().counter.get();
+}
+
+MetricHistogram* MetricsExporter::histogram(const char* name, const char* help, std::vector<double> bounds)
+{
+	metrics.push_back({name, help, Histogram, nullptr, nullptr, std::unique_ptr<MetricHistogram>(new MetricHistogram), bounds});
+	return metrics.back().histogram.get();
+}
+
+bool MetricsExporter::start(const char* socketPath)
+{
+	stop();
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path)) {
+		std::cout << "ERROR::METRICS::SOCKET_PATH_TOO_LONG " << socketPath << std::endl;
+		return false;
+	}
+	strcpy(address.sun_path, socketPath);
+
+	listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	//a socket file left behind by an earlier run would make bind fail, anything else at that path is left alone
+	struct stat existing;
+	if (lstat(socketPath, &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+		unlink(socketPath);
+	}
+	if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0) {
+		std::cout << "ERROR::METRICS::COULD_NOT_LISTEN " << socketPath << ": " << strerror(errno) << std::endl;
+		if (listener >= 0) {
+			close(listener);
+		}
+		listener = -1;
+		return false;
+	}
+	path = socketPath;
+	stopping = false;
+	worker = std::thread(&MetricsExporter::serve, this);
+	return true;
+}
+
+void MetricsExporter::stop()
+{
+	if (listener < 0) {
+		return;
+	}
+	stopping = true;
+	worker.join();
+	close(listener);
+	listener = -1;
+	unlink(path.c_str());
+}
+
+void MetricsExporter::serve()
+{
+	while (!stopping) {
+		//wakes up now and then to notice stop()
+		pollfd waiting = {listener, POLLIN, 0};
+		if (poll(&waiting, 1, 200) <= 0) {
+			continue;
+		}
+		int client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+		if (client < 0) {
+			continue;
+		}
+		//whatever the client sends first, a short wait so a silent `socat` still gets its answer
+		char request[512];
+		ssize_t received = 0;
+		pollfd reading = {client, POLLIN, 0};
+		if (poll(&reading, 1, 100) > 0) {
+			received = recv(client, request, sizeof(request) - 1, 0);
+		}
+		bool http = received >= 4 && memcmp(request, "GET ", 4) == 0;
+
+		std::string body = render();
+		std::string response;
+		if (http) {
+			response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+				std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+		}
+		response += body;
+		size_t sent = 0;
+		while (sent < response.size()) {
+			ssize_t written = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+			if (written <= 0) {
+				break;
+			}
+			sent += written;
+		}
+		close(client);
+	}
+}
+
+static void header(std::ostream& out, const std::string& name, const std::string& help, const char* type)
+{
+	out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+std::string MetricsExporter::render() const
+{
+	std::ostringstream out;
+	out.precision(12);
+	for (const Metric& metric : metrics) {
+		switch (metric.kind) {
+		case Gauge:
+			header(out, metric.name, metric.help, "gauge");
+			out << metric.name << " " << metric.gauge->value.load(std::memory_order_relaxed) << "\n";
+			break;
+		case Counter:
+			header(out, metric.name, metric.help, "counter");
+			out << metric.name << " " << metric.counter->value.load(std::memory_order_relaxed) << "\n";
+			break;
+		case Histogram: {
+			const MetricHistogram& histogram = *metric.histogram;
+			//read the count first, buckets recorded meanwhile can only make the +Inf bucket look short by a frame
+			uint64_t recorded = histogram.count();
+			header(out, metric.name, metric.help, "histogram");
+			for (double bound : metric.bounds) {
+				out << metric.name << "_bucket{le=\"" << bound << "\"} " << std::min(histogram.countBelow(bound), recorded) << "\n";
+			}
+			out << metric.name << "_bucket{le=\"+Inf\"} " << recorded << "\n";
+			out << metric.name << "_sum " << histogram.sum() << "\n";
+			out << metric.name << "_count " << recorded << "\n";
+
+			std::string quantiles = metric.name + "_quantile";
+			header(out, quantiles, metric.help + ", whole run quantiles (1 is the maximum)", "gauge");
+			const double qs[] = {0.5, 0.9, 0.99};
+			for (double q : qs) {
+				out << quantiles << "{quantile=\"" << q << "\"} " << histogram.quantile(q) << "\n";
+			}
+			out << quantiles << "{quantile=\"1\"} " << histogram.max() << "\n";
+			break;
+		}
+		}
+	}
+
+	//process wide numbers, cheap enough to read per scrape
+	long pageSize = sysconf(_SC_PAGESIZE);
+	unsigned long long virtualPages = 0, residentPages = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm) {
+		if (fscanf(statm, "%llu %llu", &virtualPages, &residentPages) != 2) {
+			virtualPages = residentPages = 0;
+		}
+		fclose(statm);
+	}
+	header(out, "process_resident_memory_bytes", "resident set size", "gauge");
+	out << "process_resident_memory_bytes " << residentPages * pageSize << "\n";
+	header(out, "process_virtual_memory_bytes", "virtual memory size", "gauge");
+	out << "process_virtual_memory_bytes " << virtualPages * pageSize << "\n";
+	header(out, "process_uptime_seconds", "seconds since the metrics were set up", "gauge");
+	out << "process_uptime_seconds " << (steadyNanoseconds() - startTicks) / 1e9 << "\n";
+	return out.str();
+}
@@ -0,0 +1,119 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//metrics the render thread updates with a few relaxed atomic operations, read by the exporter thread whenever
+//someone scrapes, so publishing never waits on anything
+
+struct MetricGauge
+{
+	std::atomic<double> value{0.0};
+
+	void set(double amount) { value.store(amount, std::memory_order_relaxed); }
+};
+
+struct MetricCounter
+{
+	std::atomic<uint64_t> value{0};
+
+	void add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+};
+
+//hdr histogram style: exact below 64 units, above that 32 sub-buckets per power of two (about 3% error)
+//from 1 unit up to 2^40, in a fixed array so recording is an index calculation & an increment
+class MetricHistogram
+{
+public:
+	//unit: the smallest step in seconds, 1 microsecond for frame times
+	explicit MetricHistogram(double unit = 1e-6);
+
+	void record(double seconds);
+
+	uint64_t count() const { return total.load(std::memory_order_relaxed); }
+	double sum() const { return sumUnits.load(std::memory_order_relaxed) * unit; }
+	double max() const { return maxUnits.load(std::memory_order_relaxed) * unit; }
+	//the value q (0..1) of the recorded ones are at or below, in seconds
+	double quantile(double q) const;
+	//how many recorded values are at or below seconds (to the bucket's precision)
+	uint64_t countBelow(double seconds) const;
+
+private:
+	static const int linearBuckets = 64;
+	static const int subBuckets = 32;
+	static const int magnitudes = 35;
+	static const int bucketCount = linearBuckets + magnitudes * subBuckets;
+
+	double unit;
+	std::atomic<uint64_t> counts[bucketCount];
+	std::atomic<uint64_t> total{0};
+	std::atomic<uint64_t> sumUnits{0};
+	std::atomic<uint64_t> maxUnits{0};
+
+	static int bucket(uint64_t units);
+	//the smallest & largest value a bucket holds, in units
+	static uint64_t bucketLow(int index);
+	static uint64_t bucketHigh(int index);
+};
+
+//owns the metrics and serves them in the prometheus text format on a unix socket from a background thread
+//plain text for anything, with an http header when the request looks like http, so both
+//  curl --unix-socket <path> http://localhost/metrics   and   socat - UNIX-CONNECT:<path>
+//work, as does a prometheus scraping through a socket proxy
+//process memory (rss & virtual) is read from /proc by the exporter thread, the render thread never pays for it
+class MetricsExporter
+{
+public:
+	MetricsExporter();
+	~MetricsExporter();
+	MetricsExporter(const MetricsExporter&) = delete;
+	MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+	//register everything before start(), the pointers stay valid as long as the exporter lives
+	MetricGauge* gauge(const char* name, const char* help);
+	MetricCounter* counter(const char* name, const char* help);
+	//exported as a prometheus histogram with buckets at the given bounds (seconds, ascending) plus
+	//<name>_quantile gauges for p50/p90/p99/max over the whole run
+	MetricHistogram* histogram(const char* name, const char* help, std::vector<double> bounds);
+
+	bool start(const char* socketPath);
+	void stop();
+	bool running() const { return listener >= 0; }
+
+	//everything in the prometheus text format, what a scrape gets
+	std::string render() const;
+
+private:
+	enum Kind
+	{
+		Gauge,
+		Counter,
+		Histogram
+	};
+	struct Metric
+	{
+		std::string name;
+		std::string help;
+		Kind kind;
+		std::unique_ptr<MetricGauge> gauge;
+		std::unique_ptr<MetricCounter> counter;
+		std::unique_ptr<MetricHistogram> histogram;
+		std::vector<double> bounds;
+	};
+
+	std::vector<Metric> metrics;
+	uint64_t startTicks;
+	int listener = -1;
+	std::string path;
+	std::atomic<bool> stopping{false};
+	std::thread worker;
+
+	void serve();
+};
+
+#endif // !METRICS_H
@@ -0,0 +1,533 @@
+#include "mipmap.h"
+#include "image.h"
+#include "texture.h"
+#include "cpuprofile.h"
+
+#include <glad/glad.h>
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define MIPMAP_SSE 1
+//avx2 kernels are compiled with a target attribute and picked at runtime
+#define MIPMAP_AVX2 1
+#endif
+
+//srgb <-> linear lookup tables, built once on first use
+struct GammaTables
+{
+	float toLinear[256];
+	unsigned char toSrgb[4096];
+
+	GammaTables()
+	{
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 4096; i++) {
+			float l = i / 4095.0f;
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			toSrgb[i] = (unsigned char)std::clamp((int)(c * 255.0f + 0.5f), 0, 255);
+		}
+	}
+};
+
+static const GammaTables& gammaTables()
+{
+	static GammaTables tables;
+	return tables;
+}
+
+int mipLevelCount(int width, int height)
+{
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		levels++;
+	}
+	return levels;
+}
+
+static size_t layoutLevels(int width, int height, std::vector<MipLevel>& levels)
+{
+	levels.clear();
+	size_t offset = 0;
+	int count = mipLevelCount(width, height);
+	for (int i = 0; i < count; i++) {
+		levels.push_back({width, height, offset});
+		offset += (size_t)width * height * 4;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return offset;
+}
+
+void MipChain::allocate(int width, int height)
+{
+	pixels.resize(layoutLevels(width, height, levels));
+}
+
+// ---- srgb bytes -> linear floats ----
+
+static void toLinearScalar(const unsigned char* src, float* dst, size_t count)
+{
+	const GammaTables& tables = gammaTables();
+	for (size_t i = 0; i < count; i++) {
+		dst[i * 4 + 0] = tables.toLinear[src[i * 4 + 0]];
+		dst[i * 4 + 1] = tables.toLinear[src[i * 4 + 1]];
+		dst[i * 4 + 2] = tables.toLinear[src[i * 4 + 2]];
+		dst[i * 4 + 3] = src[i * 4 + 3] * (1.0f / 255.0f);
+	}
+}
+
+#ifdef MIPMAP_AVX2
+//two pixels per iteration, the table lookups are one gather and alpha is blended in separately
+__attribute__((target("avx2")))
+static void toLinearAvx2(const unsigned char* src, float* dst, size_t count)
+{
+	const float* table = gammaTables().toLinear;
+	const __m256 alphaScale = _mm256_set1_ps(1.0f / 255.0f);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i * 4)));
+		__m256 linear = _mm256_i32gather_ps(table, bytes, 4);
+		__m256 alpha = _mm256_mul_ps(_mm256_cvtepi32_ps(bytes), alphaScale);
+		_mm256_storeu_ps(dst + i * 4, _mm256_blend_ps(linear, alpha, 0x88));
+	}
+	toLinearScalar(src + i * 4, dst + i * 4, count - i);
+}
+#endif
+
+// ---- 2x2 box filter on linear floats ----
+
+//odd sizes drop the last row/column like any 2x2 box, a 1 texel wide source repeats its edge
+static void downsampleRowScalar(const float* row0, const float* row1, int srcWidth, float* dst, int dstWidth, int x)
+{
+	for (; x < dstWidth; x++) {
+		int x0 = x * 2;
+		int x1 = std::min(x0 + 1, srcWidth - 1);
+		for (int c = 0; c < 4; c++) {
+			dst[x * 4 + c] = (row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c]) * 0.25f;
+		}
+	}
+}
+
+#ifdef MIPMAP_SSE
+//one rgba pixel fits exactly in an __m128
+static void downsampleRowSse(const float* row0, const float* row1, int srcWidth, float* dst, int dstWidth)
+{
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	int x = 0;
+	for (; x < dstWidth && x * 2 + 1 < srcWidth; x++) {
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x * 8), _mm_loadu_ps(row0 + x * 8 + 4)),
+			_mm_add_ps(_mm_loadu_ps(row1 + x * 8), _mm_loadu_ps(row1 + x * 8 + 4)));
+		_mm_storeu_ps(dst + x * 4, _mm_mul_ps(sum, quarter));
+	}
+	downsampleRowScalar(row0, row1, srcWidth, dst, dstWidth, x);
+}
+#endif
+
+#ifdef MIPMAP_AVX2
+//two destination pixels per iteration: add the rows, then add neighbouring pixels across the 128 bit lanes
+__attribute__((target("avx2")))
+static void downsampleRowAvx2(const float* row0, const float* row1, int srcWidth, float* dst, int dstWidth)
+{
+	const __m256 quarter = _mm256_set1_ps(0.25f);
+	int x = 0;
+	for (; x + 2 <= dstWidth && x * 2 + 3 < srcWidth; x += 2) {
+		__m256 low = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8));
+		__m256 high = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+		__m256 even = _mm256_permute2f128_ps(low, high, 0x20);
+		__m256 odd = _mm256_permute2f128_ps(low, high, 0x31);
+		_mm256_storeu_ps(dst + x * 4, _mm256_mul_ps(_mm256_add_ps(even, odd), quarter));
+	}
+	downsampleRowScalar(row0, row1, srcWidth, dst, dstWidth, x);
+}
+#endif
+
+// ---- linear floats -> srgb bytes ----
+
+static void toSrgbScalar(const float* src, unsigned char* dst, size_t count)
+{
+	const GammaTables& tables = gammaTables();
+	for (size_t i = 0; i < count; i++) {
+		for (int c = 0; c < 3; c++) {
+			dst[i * 4 + c] = tables.toSrgb[(int)(std::clamp(src[i * 4 + c], 0.0f, 1.0f) * 4095.0f + 0.5f)];
+		}
+		dst[i * 4 + 3] = (unsigned char)(std::clamp(src[i * 4 + 3], 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+}
+
+#ifdef MIPMAP_SSE
+//the clamp, scale and rounding are vectorized, only the table reads stay scalar
+static void toSrgbSse(const float* src, unsigned char* dst, size_t count)
+{
+	const unsigned char* table = gammaTables().toSrgb;
+	const __m128 scale = _mm_setr_ps(4095.0f, 4095.0f, 4095.0f, 255.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	alignas(16) int32_t index[4];
+	for (size_t i = 0; i < count; i++) {
+		__m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i * 4), zero), one);
+		_mm_store_si128((__m128i*)index, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+		dst[i * 4 + 0] = table[index[0]];
+		dst[i * 4 + 1] = table[index[1]];
+		dst[i * 4 + 2] = table[index[2]];
+		dst[i * 4 + 3] = (unsigned char)index[3];
+	}
+}
+#endif
+
+// ---- dispatch ----
+
+typedef void (*ToLinearFn)(const unsigned char*, float*, size_t);
+typedef void (*DownsampleRowFn)(const float*, const float*, int, float*, int);
+typedef void (*ToSrgbFn)(const float*, unsigned char*, size_t);
+
+static void downsampleRowPlain(const float* row0, const float* row1, int srcWidth, float* dst, int dstWidth)
+{
+	downsampleRowScalar(row0, row1, srcWidth, dst, dstWidth, 0);
+}
+
+struct MipKernels
+{
+	ToLinearFn toLinear = toLinearScalar;
+	DownsampleRowFn downsampleRow = downsampleRowPlain;
+	ToSrgbFn toSrgb = toSrgbScalar;
+
+	MipKernels()
+	{
+#ifdef MIPMAP_SSE
+		downsampleRow = downsampleRowSse;
+		toSrgb = toSrgbSse;
+#endif
+#ifdef MIPMAP_AVX2
+		if (__builtin_cpu_supports("avx2")) {
+			toLinear = toLinearAvx2;
+			downsampleRow = downsampleRowAvx2;
+		}
+#endif
+	}
+};
+
+static const MipKernels& mipKernels()
+{
+	static MipKernels kernels;
+	return kernels;
+}
+
+//runs f(firstRow, endRow) over bands of rows, one band per thread (the caller takes the last one)
+template <typename F>
+static void parallelRows(int rows, int threads, size_t rowPixels, F f)
+{
+	//not worth waking threads for the tiny levels at the end of the chain
+	const size_t minPixelsPerThread = 16384;
+	threads = std::min<int>(threads, (int)std::max<size_t>(1, rows * rowPixels / minPixelsPerThread));
+	threads = std::clamp(threads, 1, rows);
+	std::vector<std::thread> workers;
+	int band = (rows + threads - 1) / threads;
+	//rounding the band up can leave fewer bands than threads (1024 rows over 48 threads is 47 bands of 22),
+	//the last band must still start inside the level
+	threads = (rows + band - 1) / band;
+	for (int t = 0; t + 1 < threads; t++) {
+		workers.emplace_back([&f](int y0, int y1) {
+			setCpuProfileThreadName("mip worker");
+			CPU_ZONE("mip rows");
+			f(y0, y1);
+		}, t * band, std::min(rows, (t + 1) * band));
+	}
+	f((threads - 1) * band, rows);
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void generateMipChain(MipChain& chain, int threads)
+{
+	CPU_ZONE("generateMipChain");
+	if (threads <= 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	const MipKernels& kernels = mipKernels();
+
+	//the whole chain is filtered from linear floats so rounding does not build up level after level
+	const MipLevel& base = chain.levels[0];
+	std::vector<float> current((size_t)base.width * base.height * 4);
+	std::vector<float> next(chain.levels.size() > 1 ? (size_t)chain.levels[1].width * chain.levels[1].height * 4 : 0);
+	parallelRows(base.height, threads, base.width, [&](int y0, int y1) {
+		size_t start = (size_t)y0 * base.width;
+		kernels.toLinear(chain.level(0) + start * 4, current.data() + start * 4, (size_t)(y1 - y0) * base.width);
+	});
+
+	for (size_t i = 1; i < chain.levels.size(); i++) {
+		const MipLevel& src = chain.levels[i - 1];
+		const MipLevel& dst = chain.levels[i];
+		unsigned char* out = chain.level(i);
+		parallelRows(dst.height, threads, dst.width, [&](int y0, int y1) {
+			for (int y = y0; y < y1; y++) {
+				const float* row0 = current.data() + (size_t)std::min(y * 2, src.height - 1) * src.width * 4;
+				const float* row1 = current.data() + (size_t)std::min(y * 2 + 1, src.height - 1) * src.width * 4;
+				kernels.downsampleRow(row0, row1, src.width, next.data() + (size_t)y * dst.width * 4, dst.width);
+			}
+			size_t start = (size_t)y0 * dst.width;
+			kernels.toSrgb(next.data() + start * 4, out + start * 4, (size_t)(y1 - y0) * dst.width);
+		});
+		std::swap(current, next);
+	}
+}
+
+// ---- cache ----
+
+struct MipCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	MipStamp stamp;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	uint32_t reserved;
+};
+
+static const uint32_t mipCacheVersion = 2;
+
+static std::string mipCachePath(const char* assetPath)
+{
+	return std::string(assetPath) + ".mips";
+}
+
+//what the cache has to match, so edited assets regenerate their chain
+static bool sourceStamp(const char* assetPath, MipStamp& stamp)
+{
+	std::error_code error;
+	stamp.source = std::filesystem::file_size(assetPath, error);
+	if (error) {
+		return false;
+	}
+	stamp.params = std::filesystem::last_write_time(assetPath, error).time_since_epoch().count();
+	return !error;
+}
+
+//reads and checks the header, leaving the file positioned at the pixels
+static FILE* openMipFile(const std::string& path, const MipStamp& stamp, std::vector<MipLevel>& levels, size_t& size)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) {
+		return NULL;
+	}
+	MipCacheHeader header;
+	if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "MIPS", 4) == 0
+		&& header.version == mipCacheVersion && header.stamp.source == stamp.source && header.stamp.params == stamp.params
+		&& header.width > 0 && header.height > 0) {
+		size = layoutLevels(header.width, header.height, levels);
+		if (levels.size() == header.levels) {
+			return file;
+		}
+	}
+	fclose(file);
+	return NULL;
+}
+
+bool loadMipFile(const std::string& path, const MipStamp& stamp, MipChain& chain)
+{
+	size_t size;
+	FILE* file = openMipFile(path, stamp, chain.levels, size);
+	if (!file) {
+		return false;
+	}
+	chain.pixels.resize(size);
+	bool success = fread(chain.pixels.data(), 1, size, file) == size;
+	fclose(file);
+	return success;
+}
+
+bool saveMipFile(const std::string& path, const MipStamp& stamp, const MipChain& chain)
+{
+	if (chain.levels.empty()) {
+		return false;
+	}
+	MipCacheHeader header = {};
+	memcpy(header.magic, "MIPS", 4);
+	header.version = mipCacheVersion;
+	header.stamp = stamp;
+	header.width = chain.levels[0].width;
+	header.height = chain.levels[0].height;
+	header.levels = chain.levels.size();
+
+	//written to a temporary name first so a crash never leaves a half written cache behind
+	std::string temporary = path + ".tmp";
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(chain.pixels.data(), 1, chain.pixels.size(), file) == chain.pixels.size();
+	success = fclose(file) == 0 && success;
+	std::error_code error;
+	if (success) {
+		std::filesystem::rename(temporary, path, error);
+	}
+	else {
+		std::filesystem::remove(temporary, error);
+	}
+	return success && !error;
+}
+
+bool loadMipCache(const char* assetPath, MipChain& chain)
+{
+	MipStamp stamp;
+	return sourceStamp(assetPath, stamp) && loadMipFile(mipCachePath(assetPath), stamp, chain);
+}
+
+bool saveMipCache(const char* assetPath, const MipChain& chain)
+{
+	MipStamp stamp;
+	return sourceStamp(assetPath, stamp) && saveMipFile(mipCachePath(assetPath), stamp, chain);
+}
+
+// ---- upload ----
+
+static void uploadLevels(const std::vector<MipLevel>& levels, const unsigned char* base, int firstLevel = 0)
+{
+	int count = levels.size() - firstLevel;
+	allocateTextureStorage(GL_RGBA8, count, levels[firstLevel].width, levels[firstLevel].height);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (int i = 0; i < count; i++) {
+		const MipLevel& level = levels[firstLevel + i];
+		glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, base + level.offset);
+	}
+}
+
+void uploadMipChain(const MipChain& chain, int firstLevel)
+{
+	uploadLevels(chain.levels, chain.pixels.data(), std::clamp(firstLevel, 0, (int)chain.levels.size() - 1));
+}
+
+//a valid file is read straight into a mapped pixel buffer, the cpu never touches the pixels
+bool uploadMipFile(const std::string& path, const MipStamp& stamp, int* width, int* height)
+{
+	std::vector<MipLevel> levels;
+	size_t size;
+	FILE* file = openMipFile(path, stamp, levels, size);
+	if (!file) {
+		return false;
+	}
+	unsigned int pbo;
+	glGenBuffers(1, &pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	bool success = dst && fread(dst, 1, size, file) == size;
+	fclose(file);
+	if (dst && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+		success = false;
+	}
+	if (success) {
+		uploadLevels(levels, NULL);
+		if (width) {
+			*width = levels[0].width;
+		}
+		if (height) {
+			*height = levels[0].height;
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &pbo);
+	return success;
+}
+
+static bool decodeMipChain(const char* path, MipChain& chain)
+{
+	ImageDecoder decoder;
+	if (!decoder.open(path)) {
+		return false;
+	}
+	chain.allocate(decoder.width, decoder.height);
+	return decoder.decode(chain.level(0), (size_t)decoder.width * 4);
+}
+
+//decodes and generates the chain, then writes the cache for next time
+static bool buildMipCache(const char* path, MipChain& chain)
+{
+	if (!decodeMipChain(path, chain)) {
+		return false;
+	}
+	generateMipChain(chain);
+	if (!saveMipCache(path, chain)) {
+		std::cout << "Failed to write mip cache for " << path << std::endl;
+	}
+	return true;
+}
+
+bool loadMipmappedChain(const char* path, MipChain& chain)
+{
+	return loadMipCache(path, chain) || buildMipCache(path, chain);
+}
+
+static double millisecondsSince(Uint64 start)
+{
+	return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void benchmarkMipGeneration(const char* path)
+{
+	MipChain chain;
+	if (!decodeMipChain(path, chain)) {
+		std::cout << "Failed to load " << path << std::endl;
+		return;
+	}
+	const int runs = 10;
+	std::cout << "mip chain for " << path << " (" << chain.levels[0].width << "x" << chain.levels[0].height
+		<< ", " << chain.levels.size() << " levels, best of " << runs << ")" << std::endl;
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	double glTime = 1e30;
+	for (int i = 0; i < runs; i++) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, chain.levels[0].width, chain.levels[0].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, chain.level(0));
+		glFinish();
+		Uint64 start = SDL_GetPerformanceCounter();
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glFinish();
+		glTime = std::min(glTime, millisecondsSince(start));
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDeleteTextures(1, &texture);
+
+	double singleTime = 1e30, threadedTime = 1e30, cacheTime = 1e30;
+	for (int i = 0; i < runs; i++) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		generateMipChain(chain, 1);
+		singleTime = std::min(singleTime, millisecondsSince(start));
+		start = SDL_GetPerformanceCounter();
+		generateMipChain(chain);
+		threadedTime = std::min(threadedTime, millisecondsSince(start));
+	}
+	if (saveMipCache(path, chain)) {
+		MipChain cached;
+		for (int i = 0; i < runs; i++) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			loadMipCache(path, cached);
+			cacheTime = std::min(cacheTime, millisecondsSince(start));
+		}
+	}
+
+	std::cout << "  glGenerateMipmap: " << glTime << " ms" << std::endl;
+	std::cout << "  cpu, 1 thread: " << singleTime << " ms" << std::endl;
+	std::cout << "  cpu, " << std::max(1u, std::thread::hardware_concurrency()) << " threads: " << threadedTime << " ms" << std::endl;
+	std::cout << "  cache read: " << cacheTime << " ms" << std::endl;
+}
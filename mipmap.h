@@ -0,0 +1,64 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//one level of a mip chain, offset is into MipChain::pixels
+struct MipLevel
+{
+	int width;
+	int height;
+	size_t offset;
+};
+
+//a full rgba8 mip chain in one buffer, level 0 first
+struct MipChain
+{
+	std::vector<MipLevel> levels;
+	std::vector<unsigned char> pixels;
+
+	//lays out the levels for a width x height base image and sizes the buffer
+	void allocate(int width, int height);
+	unsigned char* level(int i) { return pixels.data() + levels[i].offset; }
+	const unsigned char* level(int i) const { return pixels.data() + levels[i].offset; }
+};
+
+//number of levels gl expects down to 1x1
+int mipLevelCount(int width, int height);
+
+//fills levels 1..n from level 0 with a 2x2 box filter done in linear light
+//(rgb is treated as srgb, alpha as linear), split over threads by rows
+//threads = 0 picks std::thread::hardware_concurrency
+void generateMipChain(MipChain& chain, int threads = 0);
+
+//what a chain on disk was made from, a file is only used when its stamp matches
+//(size & mtime for asset caches, input hash & parameter hash for baked textures)
+struct MipStamp
+{
+	uint64_t source;
+	uint64_t params;
+};
+
+bool loadMipFile(const std::string& path, const MipStamp& stamp, MipChain& chain);
+bool saveMipFile(const std::string& path, const MipStamp& stamp, const MipChain& chain);
+
+//the chain is cached next to the asset as <path>.mips and is thrown away when the asset changes
+bool loadMipCache(const char* assetPath, MipChain& chain);
+bool saveMipCache(const char* assetPath, const MipChain& chain);
+
+//allocates storage for the bound GL_TEXTURE_2D and uploads the levels from firstLevel down
+//(firstLevel > 0 leaves the biggest levels out to save memory)
+void uploadMipChain(const MipChain& chain, int firstLevel = 0);
+//same from a file on disk, read straight into a pixel buffer, false if it is missing or stale
+bool uploadMipFile(const std::string& path, const MipStamp& stamp, int* width = NULL, int* height = NULL);
+
+//the asset's chain from its cache, or decoded & generated (and cached) if the cache is stale
+bool loadMipmappedChain(const char* path, MipChain& chain);
+
+//times glGenerateMipmap against the cpu generator and the cache for one asset
+void benchmarkMipGeneration(const char* path);
+
+#endif // !MIPMAP_H
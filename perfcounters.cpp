@@ -0,0 +1,178 @@
+#include "perfcounters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+const char* const perfCounterNames[PerfCounterCount] = {"cycles", "instructions", "llc_misses", "branch_misses", "task_clock_ns"};
+
+static const struct
+{
+	uint32_t type;
+	uint64_t config;
+} perfEvents[PerfCounterCount] = {
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}
+};
+
+PerfSample& PerfSample::operator+=(const PerfSample& other)
+{
+	for (int i = 0; i < PerfCounterCount; i++) {
+		values[i] += other.values[i];
+	}
+	return *this;
+}
+
+PerfSample PerfSample::operator-(const PerfSample& other) const
+{
+	PerfSample difference;
+	for (int i = 0; i < PerfCounterCount; i++) {
+		difference.values[i] = values[i] - other.values[i];
+	}
+	return difference;
+}
+
+PerfCounters::PerfCounters()
+{
+	for (int i = 0; i < PerfCounterCount; i++) {
+		fds[i] = -1;
+		slots[i] = -1;
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+	close();
+}
+
+//whatever the kernel is set to, for the message when it says no
+static std::string paranoidLevel()
+{
+	FILE* file = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+	if (!file) {
+		return "unknown";
+	}
+	char text[16] = {};
+	if (!fgets(text, sizeof(text), file)) {
+		text[0] = '\0';
+	}
+	fclose(file);
+	std::string level = text;
+	while (!level.empty() && (level.back() == '\n' || level.back() == ' ')) {
+		level.pop_back();
+	}
+	return level;
+}
+
+bool PerfCounters::open()
+{
+	close();
+	std::string missing;
+	int error = 0;
+	for (int i = 0; i < PerfCounterCount; i++) {
+		perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = perfEvents[i].type;
+		attributes.config = perfEvents[i].config;
+		//the whole group starts together once everything is in
+		attributes.disabled = leader < 0;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		//this thread on whichever cpu it runs
+		int fd = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0);
+		if (fd < 0) {
+			error = errno;
+			missing += std::string(missing.empty() ? "" : ", ") + perfCounterNames[i];
+			continue;
+		}
+		if (leader < 0) {
+			leader = fd;
+		}
+		fds[i] = fd;
+		slots[i] = count++;
+	}
+	if (!missing.empty()) {
+		std::cout << "perf counters: no " << missing << " (" << strerror(error) << ", perf_event_paranoid is "
+			<< paranoidLevel() << ")" << std::endl;
+	}
+	if (leader < 0) {
+		return false;
+	}
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+
+void PerfCounters::close()
+{
+	for (int i = 0; i < PerfCounterCount; i++) {
+		if (fds[i] >= 0) {
+			::close(fds[i]);
+		}
+		fds[i] = -1;
+		slots[i] = -1;
+	}
+	leader = -1;
+	count = 0;
+}
+
+bool PerfCounters::read(PerfSample& sample) const
+{
+	if (leader < 0) {
+		return false;
+	}
+	//PERF_FORMAT_GROUP: the number of counters, time enabled & running, then each counter in the order opened
+	uint64_t buffer[3 + PerfCounterCount];
+	ssize_t size = ::read(leader, buffer, sizeof(buffer));
+	if (size < (ssize_t)(3 * sizeof(uint64_t)) || buffer[0] != (uint64_t)count) {
+		return false;
+	}
+	uint64_t enabled = buffer[1];
+	uint64_t running = buffer[2];
+	for (int i = 0; i < PerfCounterCount; i++) {
+		if (slots[i] < 0) {
+			sample.values[i] = 0;
+			continue;
+		}
+		uint64_t value = buffer[3 + slots[i]];
+		//only counted part of the time, extrapolate to all of it
+		if (running > 0 && running < enabled) {
+			value = (uint64_t)((double)value * enabled / running);
+		}
+		sample.values[i] = value;
+	}
+	return true;
+}
+
+void printPerfSample(std::ostream& out, const PerfCounters& counters, const PerfSample& sample, uint64_t frames)
+{
+	if (frames == 0) {
+		frames = 1;
+	}
+	out << "perf:";
+	for (int i = 0; i < PerfCounterCount; i++) {
+		out << (i ? ", " : " ") << perfCounterNames[i] << " ";
+		if (counters.available((PerfCounter)i)) {
+			out << sample.values[i] / frames;
+		}
+		else {
+			out << "n/a";
+		}
+	}
+	if (counters.available(PerfCycles) && counters.available(PerfInstructions) && sample.values[PerfCycles] > 0) {
+		out << ", ipc " << (double)sample.values[PerfInstructions] / sample.values[PerfCycles];
+	}
+	out << std::endl;
+}
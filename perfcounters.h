@@ -0,0 +1,61 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <ostream>
+
+//what the cpu did, for the regressions wall clock time can't explain (cache misses, mispredicted branches)
+enum PerfCounter
+{
+	PerfCycles,
+	PerfInstructions,
+	PerfCacheMisses,  // last level cache
+	PerfBranchMisses,
+	PerfTaskClock,    // nanoseconds on a cpu, a software counter so it works where the hardware ones don't (e.g. vms)
+	PerfCounterCount
+};
+
+//as they appear in bench json & summaries
+extern const char* const perfCounterNames[PerfCounterCount];
+
+struct PerfSample
+{
+	uint64_t values[PerfCounterCount] = {};
+
+	PerfSample& operator+=(const PerfSample& other);
+	PerfSample operator-(const PerfSample& other) const;
+};
+
+//linux perf_event counters of the thread that opened them (here that's the main thread, which is also the one
+//that renders), user space only so the default perf_event_paranoid of 2 still allows them
+//counters the cpu, kernel or a stricter paranoid setting won't give us are just left out, reading never fails loudly
+class PerfCounters
+{
+public:
+	PerfCounters();
+	~PerfCounters();
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	//opens whatever it can, says once which counters are missing & why, false if none could be opened
+	bool open();
+	void close();
+	bool opened() const { return leader >= 0; }
+	bool available(PerfCounter counter) const { return slots[counter] >= 0; }
+
+	//totals since open(), scaled up if the kernel had to share the hardware counters with someone else
+	bool read(PerfSample& sample) const;
+
+private:
+	int leader = -1;
+	int fds[PerfCounterCount];
+	//position of each counter in the group read, -1 when it isn't open
+	int slots[PerfCounterCount];
+	//counters in the group
+	int count = 0;
+};
+
+//one summary line, sample divided by frames, missing counters print as n/a
+void printPerfSample(std::ostream& out, const PerfCounters& counters, const PerfSample& sample, uint64_t frames = 1);
+
+#endif // !PERFCOUNTERS_H
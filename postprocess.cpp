@@ -0,0 +1,217 @@
+#include "postprocess.h"
+#include "cpuprofile.h"
+#include "renderstats.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+const std::vector<PostEffect>& builtinPostEffects()
+{
+	static const std::vector<PostEffect> effects = {
+		{"sharpen", PostEffectKind::Sampling, {{"amount", 0.5f}}},
+		{"tonemap", PostEffectKind::PerPixel, {{"exposure", 1.0f}}},
+		{"grade", PostEffectKind::PerPixel, {{"contrast", 1.1f}, {"saturation", 1.2f}, {"temperature", 0.03f}}},
+		{"vignette", PostEffectKind::PerPixel, {{"strength", 0.6f}, {"radius", 0.4f}}}
+	};
+	return effects;
+}
+
+PostProcessChain::~PostProcessChain()
+{
+	destroy();
+}
+
+bool PostProcessChain::create(const std::filesystem::path& shaderDir, const std::vector<std::string>& effectNames, bool fuse,
+	int w, int h)
+{
+	CPU_ZONE("PostProcessChain::create");
+	destroy();
+	std::vector<std::string> code;
+	for (const std::string& name : effectNames) {
+		const PostEffect* found = nullptr;
+		for (const PostEffect& effect : builtinPostEffects()) {
+			if (effect.name == name) {
+				found = &effect;
+			}
+		}
+		if (!found) {
+			std::cout << "ERROR::POSTPROCESS::UNKNOWN_EFFECT " << name << std::endl;
+			return false;
+		}
+		std::ifstream file(shaderDir / "post" / (name + ".glsl"));
+		std::stringstream text;
+		text << file.rdbuf();
+		if (!file) {
+			std::cout << "ERROR::POSTPROCESS::EFFECT_NOT_READ " << name << std::endl;
+			return false;
+		}
+		effects.push_back(*found);
+		code.push_back(text.str());
+	}
+
+	//a new pass wherever the image has to be read around the pixel (or for everything, unfused)
+	for (size_t i = 0; i < effects.size(); i++) {
+		if (stages.empty() || !fuse || effects[i].kind == PostEffectKind::Sampling) {
+			stages.push_back(Stage());
+		}
+		stages.back().effects.push_back((int)i);
+	}
+	std::ifstream vertexFile(shaderDir / "bake.vs");
+	std::stringstream vertexCode;
+	vertexCode << vertexFile.rdbuf();
+	for (Stage& stage : stages) {
+		stage.name = "post:";
+		for (size_t i = 0; i < stage.effects.size(); i++) {
+			stage.name += (i ? "+" : " ") + effects[stage.effects[i]].name;
+		}
+		stage.shader.reset(new Shader(Shader::fromSource(vertexCode.str(), generate(stage, code))));
+	}
+
+	//the triangle comes from gl_VertexID, the vertex array is only there to be bound
+	glGenVertexArrays(1, &vertexArray);
+	width = w;
+	height = h;
+	uploadParams();
+	return true;
+}
+
+std::string PostProcessChain::generate(const Stage& stage, const std::vector<std::string>& code) const
+{
+	std::ostringstream source;
+	source << "#version 130\n\n// generated by PostProcessChain\nvarying vec2 TexCoord;\n\n"
+		"uniform sampler2D source;\n//one texel of source, in texture coordinates\nuniform vec2 texel;\n\n";
+	for (int index : stage.effects) {
+		source << code[index] << "\n";
+	}
+	source << "void main()\n{\n    vec2 uv = TexCoord;\n";
+	size_t first = 0;
+	if (effects[stage.effects[0]].kind == PostEffectKind::Sampling) {
+		source << "    vec4 color = " << effects[stage.effects[0]].name << "(uv);\n";
+		first = 1;
+	}
+	else {
+		source << "    vec4 color = texture2D(source, uv);\n";
+	}
+	for (size_t i = first; i < stage.effects.size(); i++) {
+		source << "    color = " << effects[stage.effects[i]].name << "(color, uv);\n";
+	}
+	source << "    gl_FragColor = color;\n}\n";
+	return source.str();
+}
+
+void PostProcessChain::uploadParams()
+{
+	int previousProgram;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	for (Stage& stage : stages) {
+		stage.shader->use();
+		stage.shader->setInt("source", 7);
+		stage.shader->setVec2("texel", 1.0f / width, 1.0f / height);
+		for (int index : stage.effects) {
+			for (const PostEffectParam& param : effects[index].params) {
+				stage.shader->setFloat(effects[index].name + "_" + param.name, param.value);
+			}
+		}
+	}
+	useProgram(previousProgram);
+}
+
+void PostProcessChain::destroy()
+{
+	for (Stage& stage : stages) {
+		glDeleteProgram(stage.shader->ID);
+	}
+	stages.clear();
+	effects.clear();
+	if (vertexArray) {
+		glDeleteVertexArrays(1, &vertexArray);
+		vertexArray = 0;
+	}
+}
+
+void PostProcessChain::setSize(int w, int h)
+{
+	if (!created() || (w == width && h == height) || w <= 0 || h <= 0) {
+		return;
+	}
+	width = w;
+	height = h;
+	uploadParams();
+}
+
+bool PostProcessChain::setParam(const std::string& effect, const std::string& param, float value)
+{
+	bool found = false;
+	for (PostEffect& candidate : effects) {
+		for (PostEffectParam& existing : candidate.params) {
+			if (candidate.name == effect && existing.name == param) {
+				existing.value = value;
+				found = true;
+			}
+		}
+	}
+	if (found) {
+		uploadParams();
+	}
+	return found;
+}
+
+void PostProcessChain::addPasses(RenderGraph& graph, RenderResource input, RenderResource output)
+{
+	//each pass reads what the one before wrote, the last one writes the output
+	RenderResource source = input;
+	for (size_t i = 0; i < stages.size(); i++) {
+		const Stage& stage = stages[i];
+		bool last = i + 1 == stages.size();
+		RenderResource destination = output;
+		graph.addPass(stage.name.c_str(),
+			[&](RenderPassBuilder& pass) {
+				pass.read(source);
+				if (last) {
+					pass.write(output);
+				}
+				else {
+					destination = pass.create(stage.name.c_str(), {width, height, GL_RGBA16F});
+				}
+			},
+			[this, &stage, source](const RenderPassContext& context) {
+				run(stage, context.texture(source));
+			});
+		source = destination;
+	}
+}
+
+void PostProcessChain::run(const Stage& stage, unsigned int source)
+{
+	CPU_ZONE("post process");
+	int previousVertexArray, previousProgram, previousUnit;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &previousUnit);
+	disableState(GL_DEPTH_TEST);
+	glBindVertexArray(vertexArray);
+	activeTexture(GL_TEXTURE7);
+
+	stage.shader->use();
+	bindTexture(GL_TEXTURE_2D, source);
+	drawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindVertexArray(previousVertexArray);
+	activeTexture(previousUnit);
+	useProgram(previousProgram);
+	enableState(GL_DEPTH_TEST);
+}
+
+void PostProcessChain::printPlan(std::ostream& out) const
+{
+	out << "post process: " << effects.size() << " effects in " << stages.size() << (stages.size() == 1 ? " pass:" : " passes:");
+	for (const Stage& stage : stages) {
+		out << " [";
+		for (size_t i = 0; i < stage.effects.size(); i++) {
+			out << (i ? "+" : "") << effects[stage.effects[i]].name;
+		}
+		out << "]";
+	}
+	out << std::endl;
+}
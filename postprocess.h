@@ -0,0 +1,84 @@
+#ifndef POSTPROCESS_H
+#define POSTPROCESS_H
+
+#include "rendergraph.h"
+#include "shader.h"
+
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//what a post effect needs from the image
+enum class PostEffectKind
+{
+	PerPixel,  // only the pixel it's on: vec4 name(vec4 color, vec2 uv), fuses with its neighbours
+	Sampling   // reads around the pixel: vec4 name(vec2 uv) on sampler2D source, has to start a pass
+};
+
+struct PostEffectParam
+{
+	std::string name;
+	float value;
+};
+
+//one effect: shaders/post/<name>.glsl holds its function & its uniforms (named <name>_<param>)
+struct PostEffect
+{
+	std::string name;
+	PostEffectKind kind;
+	std::vector<PostEffectParam> params;
+};
+
+//the effects shaders/post has code for, with their default parameters
+const std::vector<PostEffect>& builtinPostEffects();
+
+//a list of full screen effects run after the scene, each pass a render graph pass reading the one before
+//adjacent per pixel effects are compiled into one generated fragment shader, so a run of them costs one read
+//& one write of every pixel instead of one per effect (a sampling effect starts a new pass, the per pixel
+//effects after it ride along in its shader); the targets in between are the graph's transient rgba16f textures
+class PostProcessChain
+{
+public:
+	~PostProcessChain();
+
+	//effects by name, in order, fuse false gives every effect a pass of its own (to compare against)
+	bool create(const std::filesystem::path& shaderDir, const std::vector<std::string>& effectNames, bool fuse,
+		int width, int height);
+	void destroy();
+	bool created() const { return !stages.empty(); }
+	void setSize(int width, int height);
+
+	//false if no effect in the chain has that parameter
+	bool setParam(const std::string& effect, const std::string& param, float value);
+
+	//adds the passes from input (a texture the size given to create/setSize) to output
+	void addPasses(RenderGraph& graph, RenderResource input, RenderResource output);
+
+	int passes() const { return (int)stages.size(); }
+	//one line: which effects ended up in which pass
+	void printPlan(std::ostream& out) const;
+
+private:
+	struct Stage
+	{
+		//"post: " and the effects, the pass name
+		std::string name;
+		//indices into effects, a sampling one can only be first
+		std::vector<int> effects;
+		std::unique_ptr<Shader> shader;
+	};
+
+	std::vector<PostEffect> effects;
+	std::vector<Stage> stages;
+	unsigned int vertexArray = 0;
+	int width = 0;
+	int height = 0;
+
+	std::string generate(const Stage& stage, const std::vector<std::string>& code) const;
+	void uploadParams();
+	void run(const Stage& stage, unsigned int source);
+};
+
+#endif // !POSTPROCESS_H
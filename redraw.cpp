@@ -0,0 +1,64 @@
+#include "redraw.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+
+IdleStats IdleStats::operator-(const IdleStats& other) const
+{
+	IdleStats difference;
+	difference.idleSeconds = idleSeconds - other.idleSeconds;
+	difference.drawn = drawn - other.drawn;
+	difference.skipped = skipped - other.skipped;
+	difference.wakeups = wakeups - other.wakeups;
+	return difference;
+}
+
+RedrawTracker::RedrawTracker(int waitMs) : waitMs(waitMs)
+{
+}
+
+unsigned RedrawTracker::check(const glm::vec3& cameraPos, const glm::vec3& cameraFront, float fov, double sceneTime,
+	double timeScale) const
+{
+	unsigned reasons = pending;
+	//exact compares on purpose, anything that moved at all has to be drawn
+	if (cameraPos != lastCameraPos || cameraFront != lastCameraFront || fov != lastFov) {
+		reasons |= RedrawCamera;
+	}
+	if (sceneTime != lastSceneTime) {
+		reasons |= RedrawScene;
+	}
+	if (timeScale != lastTimeScale) {
+		reasons |= RedrawTimeScale;
+	}
+	return reasons;
+}
+
+void RedrawTracker::drawn(const glm::vec3& cameraPos, const glm::vec3& cameraFront, float fov, double sceneTime, double timeScale)
+{
+	lastCameraPos = cameraPos;
+	lastCameraFront = cameraFront;
+	lastFov = fov;
+	lastSceneTime = sceneTime;
+	lastTimeScale = timeScale;
+	pending = RedrawNone;
+	counts.drawn++;
+}
+
+void RedrawTracker::wait(InputSession& input)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (input.waitEvent(waitMs)) {
+		counts.wakeups++;
+	}
+	counts.idleSeconds += (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+void printIdleStats(std::ostream& out, const IdleStats& stats, double seconds)
+{
+	double idle = std::min(stats.idleSeconds, seconds);
+	out << "idle: " << (seconds > 0.0 ? idle * 100.0 / seconds : 0.0) << "% (" << idle * 1000.0 << " ms waiting, "
+		<< (seconds - idle) * 1000.0 << " ms busy), " << stats.drawn << " frames drawn, " << stats.skipped << " skipped, "
+		<< stats.wakeups << " wakeups" << std::endl;
+}
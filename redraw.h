@@ -0,0 +1,72 @@
+#ifndef REDRAW_H
+#define REDRAW_H
+
+#include "input.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <ostream>
+
+//what can make the last drawn frame out of date
+enum RedrawReason : unsigned
+{
+	RedrawNone = 0,
+	RedrawCamera = 1,     // position, direction or fov moved
+	RedrawScene = 2,      // the animation clock moved (time warp included)
+	RedrawTimeScale = 4,  // paused, resumed or sped up
+	RedrawWindow = 8,     // exposed, resized, or input arrived that the next frame should answer
+	RedrawFirst = 16      // nothing drawn yet
+};
+
+struct IdleStats
+{
+	//blocked waiting for events
+	double idleSeconds = 0.0;
+	uint64_t drawn = 0;
+	//loop turns that found nothing to draw & left the last frame on screen
+	uint64_t skipped = 0;
+	//waits that ended with an event instead of the timeout
+	uint64_t wakeups = 0;
+
+	IdleStats operator-(const IdleStats& other) const;
+};
+
+//on demand rendering: the loop keeps turning (input, simulation steps) but only draws & presents when what the
+//frame shows changed, otherwise it blocks in SDL_WaitEventTimeout with the previous frame left on screen
+//the camera, scene clock & time scale are compared to what the last drawn frame used instead of every place
+//that changes them having to remember to say so
+class RedrawTracker
+{
+public:
+	//waitMs: longest block per turn, so once a second stats & the metrics still tick over
+	explicit RedrawTracker(int waitMs = 250);
+
+	//changes that aren't in the compared state
+	void markDirty(unsigned reasons) { pending |= reasons; }
+	//what differs from the last drawn frame, RedrawNone when it's still right
+	unsigned check(const glm::vec3& cameraPos, const glm::vec3& cameraFront, float fov, double sceneTime, double timeScale) const;
+	//the state just drawn becomes the one to compare against
+	void drawn(const glm::vec3& cameraPos, const glm::vec3& cameraFront, float fov, double sceneTime, double timeScale);
+	void skipped() { counts.skipped++; }
+
+	//blocks until an event is waiting (not taking it) or the timeout, playback never waits
+	void wait(InputSession& input);
+
+	const IdleStats& stats() const { return counts; }
+
+private:
+	int waitMs;
+	unsigned pending = RedrawFirst;
+	glm::vec3 lastCameraPos = glm::vec3(0.0f);
+	glm::vec3 lastCameraFront = glm::vec3(0.0f);
+	float lastFov = 0.0f;
+	double lastSceneTime = 0.0;
+	double lastTimeScale = 0.0;
+	IdleStats counts;
+};
+
+//one line, idle against busy time over the given wall clock seconds
+void printIdleStats(std::ostream& out, const IdleStats& stats, double seconds);
+
+#endif // !REDRAW_H
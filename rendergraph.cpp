@@ -0,0 +1,399 @@
+#include "rendergraph.h"
+#include "cpuprofile.h"
+#include "gpuprofile.h"
+#include "renderstats.h"
+#include "texture.h"
+
+#include <algorithm>
+#include <iostream>
+
+uint64_t renderTextureBytes(const RenderTextureDesc& desc)
+{
+	int texelBytes = 4;
+	if (desc.format == GL_RGBA16F) {
+		texelBytes = 8;
+	}
+	else if (desc.format == GL_RGBA32F) {
+		texelBytes = 16;
+	}
+	return (uint64_t)desc.width * desc.height * texelBytes;
+}
+
+bool RenderGraphStats::operator==(const RenderGraphStats& other) const
+{
+	return passes == other.passes && culled == other.culled && transientTextures == other.transientTextures &&
+		physicalTextures == other.physicalTextures && bytesWithoutAliasing == other.bytesWithoutAliasing &&
+		bytesWithAliasing == other.bytesWithAliasing;
+}
+
+static bool sameDesc(const RenderTextureDesc& a, const RenderTextureDesc& b)
+{
+	return a.width == b.width && a.height == b.height && a.format == b.format;
+}
+
+static bool isDepth(GLenum format)
+{
+	return format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F;
+}
+
+RenderResource RenderPassBuilder::create(const char* name, const RenderTextureDesc& desc)
+{
+	RenderGraph::Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	graph.resources.push_back(resource);
+	RenderResource created = (RenderResource)graph.resources.size() - 1;
+	write(created);
+	return created;
+}
+
+void RenderPassBuilder::read(RenderResource resource)
+{
+	graph.passes[pass].reads.push_back(resource);
+}
+
+void RenderPassBuilder::write(RenderResource resource)
+{
+	RenderGraph::Resource& written = graph.resources[resource];
+	if (written.writer >= 0 && written.writer != pass && !written.imported) {
+		std::cout << "ERROR::RENDERGRAPH::SECOND_WRITER " << written.name << " in " << graph.passes[pass].name << std::endl;
+		return;
+	}
+	written.writer = pass;
+	graph.passes[pass].writes.push_back(resource);
+}
+
+void RenderPassBuilder::sideEffect()
+{
+	graph.passes[pass].sideEffect = true;
+}
+
+unsigned int RenderPassContext::texture(RenderResource resource) const
+{
+	const RenderGraph::Resource& found = graph.resources[resource];
+	return found.physical >= 0 ? graph.physicals[found.physical].texture : 0;
+}
+
+RenderGraph::RenderGraph(FrameArena& arena) : arena(arena)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	destroy();
+}
+
+RenderResource RenderGraph::importFramebuffer(const char* name, unsigned int framebuffer, int width, int height)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = {width, height, GL_RGBA8};
+	resource.imported = true;
+	resource.framebuffer = framebuffer;
+	resources.push_back(resource);
+	return (RenderResource)resources.size() - 1;
+}
+
+int RenderGraph::beginPass(const char* name)
+{
+	passes.emplace_back(arena);
+	passes.back().name = name;
+	compiled = false;
+	return (int)passes.size() - 1;
+}
+
+void RenderGraph::compile()
+{
+	CPU_ZONE("render graph compile");
+	//culling: what writes to the window or has side effects is needed, and so is whatever writes what a needed pass reads
+	std::vector<int, ArenaAllocator<int>> needed(arena);
+	needed.reserve(passes.size());
+	for (size_t i = 0; i < passes.size(); i++) {
+		Pass& pass = passes[i];
+		pass.culled = !pass.sideEffect;
+		for (RenderResource written : pass.writes) {
+			if (resources[written].imported) {
+				pass.culled = false;
+			}
+		}
+		if (!pass.culled) {
+			needed.push_back((int)i);
+		}
+	}
+	while (!needed.empty()) {
+		int pass = needed.back();
+		needed.pop_back();
+		for (RenderResource read : passes[pass].reads) {
+			int writer = resources[read].writer;
+			if (writer >= 0 && passes[writer].culled) {
+				passes[writer].culled = false;
+				needed.push_back(writer);
+			}
+		}
+	}
+
+	//ordering: a pass runs after the writers of what it reads, passes with nothing between them keep the order
+	//they were added in (a frame has a handful of passes, scanning them all beats building edge lists)
+	std::vector<int, ArenaAllocator<int>> waitingOn(passes.size(), 0, arena);
+	for (size_t i = 0; i < passes.size(); i++) {
+		if (passes[i].culled) {
+			continue;
+		}
+		for (RenderResource read : passes[i].reads) {
+			int writer = resources[read].writer;
+			if (writer >= 0 && writer != (int)i) {
+				waitingOn[i]++;
+			}
+		}
+	}
+	//the lowest index ready goes next, -1 marks the ones already placed
+	order.clear();
+	for (;;) {
+		int pass = -1;
+		for (size_t i = 0; i < passes.size() && pass < 0; i++) {
+			if (!passes[i].culled && waitingOn[i] == 0) {
+				pass = (int)i;
+			}
+		}
+		if (pass < 0) {
+			break;
+		}
+		waitingOn[pass] = -1;
+		order.push_back(pass);
+		for (size_t reader = 0; reader < passes.size(); reader++) {
+			if (passes[reader].culled || waitingOn[reader] <= 0) {
+				continue;
+			}
+			for (RenderResource read : passes[reader].reads) {
+				if (resources[read].writer == pass && (int)reader != pass) {
+					waitingOn[reader]--;
+				}
+			}
+		}
+	}
+	int live = 0;
+	for (const Pass& pass : passes) {
+		live += !pass.culled;
+	}
+	if ((int)order.size() != live) {
+		std::cout << "ERROR::RENDERGRAPH::CYCLE the passes left run in the order they were added" << std::endl;
+		for (size_t i = 0; i < passes.size(); i++) {
+			if (!passes[i].culled && std::find(order.begin(), order.end(), (int)i) == order.end()) {
+				order.push_back((int)i);
+			}
+		}
+	}
+
+	//lifetimes, from the first pass that touches a texture to the last
+	for (size_t position = 0; position < order.size(); position++) {
+		const Pass& pass = passes[order[position]];
+		for (const ResourceList* list : {&pass.writes, &pass.reads}) {
+			for (RenderResource used : *list) {
+				Resource& resource = resources[used];
+				if (resource.first < 0) {
+					resource.first = (int)position;
+				}
+				resource.last = (int)position;
+			}
+		}
+	}
+
+	//memory: a texture is taken from the pool when its first pass runs, and (aliasing) goes back after its last,
+	//so the next texture of that size & format can use it
+	for (Physical& physical : physicals) {
+		physical.free = true;
+	}
+	counts = RenderGraphStats();
+	counts.passes = (int)order.size();
+	counts.culled = (int)(passes.size() - order.size());
+	for (size_t position = 0; position < order.size(); position++) {
+		for (Resource& resource : resources) {
+			if (!resource.imported && resource.first == (int)position) {
+				resource.physical = acquire(resource.desc);
+				counts.transientTextures++;
+				counts.bytesWithoutAliasing += renderTextureBytes(resource.desc);
+			}
+		}
+		if (aliasing) {
+			for (const Resource& resource : resources) {
+				if (!resource.imported && resource.last == (int)position) {
+					physicals[resource.physical].free = true;
+				}
+			}
+		}
+	}
+	for (const Physical& physical : physicals) {
+		if (physical.usedThisFrame) {
+			counts.physicalTextures++;
+			counts.bytesWithAliasing += renderTextureBytes(physical.desc);
+		}
+	}
+	compiled = true;
+}
+
+int RenderGraph::acquire(const RenderTextureDesc& desc)
+{
+	for (size_t i = 0; i < physicals.size(); i++) {
+		if (physicals[i].free && sameDesc(physicals[i].desc, desc)) {
+			physicals[i].free = false;
+			physicals[i].usedThisFrame = true;
+			return (int)i;
+		}
+	}
+	Physical physical;
+	physical.desc = desc;
+	physical.free = false;
+	physical.usedThisFrame = true;
+	//whatever is bound on the active unit stays bound
+	int previousTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glGenTextures(1, &physical.texture);
+	glBindTexture(GL_TEXTURE_2D, physical.texture);
+	allocateTextureStorage(desc.format, 1, desc.width, desc.height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, previousTexture);
+	physicals.push_back(physical);
+	return (int)physicals.size() - 1;
+}
+
+unsigned int RenderGraph::framebufferFor(const Pass& pass, int& width, int& height)
+{
+	Attachments attachments = {};
+	int colors = 0;
+	for (RenderResource written : pass.writes) {
+		const Resource& resource = resources[written];
+		width = resource.desc.width;
+		height = resource.desc.height;
+		if (resource.imported) {
+			if (pass.writes.size() > 1) {
+				std::cout << "ERROR::RENDERGRAPH::IMPORTED_WITH_OTHER_TARGETS " << pass.name << std::endl;
+			}
+			return resource.framebuffer;
+		}
+		if (isDepth(resource.desc.format)) {
+			attachments[maxColorAttachments] = physicals[resource.physical].texture;
+		}
+		else if (colors < maxColorAttachments) {
+			attachments[colors++] = physicals[resource.physical].texture;
+		}
+		else {
+			std::cout << "ERROR::RENDERGRAPH::TOO_MANY_ATTACHMENTS " << pass.name << std::endl;
+		}
+	}
+	std::map<Attachments, unsigned int>::iterator found = framebuffers.find(attachments);
+	if (found != framebuffers.end()) {
+		return found->second;
+	}
+
+	unsigned int framebuffer;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	GLenum drawBuffers[maxColorAttachments];
+	for (int i = 0; i < colors; i++) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, attachments[i], 0);
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+	if (attachments[maxColorAttachments]) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, attachments[maxColorAttachments], 0);
+	}
+	if (colors == 0) {
+		glDrawBuffer(GL_NONE);
+	}
+	else {
+		glDrawBuffers(colors, drawBuffers);
+	}
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::RENDERGRAPH::FRAMEBUFFER_INCOMPLETE " << pass.name << std::endl;
+	}
+	framebuffers[attachments] = framebuffer;
+	return framebuffer;
+}
+
+void RenderGraph::execute()
+{
+	if (!compiled) {
+		compile();
+	}
+	for (int index : order) {
+		const Pass& pass = passes[index];
+		unsigned int framebuffer = 0;
+		if (!pass.writes.empty()) {
+			int width = 0, height = 0;
+			framebuffer = framebufferFor(pass, width, height);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			viewport(0, 0, width, height);
+		}
+		if (profiler) {
+			profiler->beginPass(pass.name);
+		}
+		pass.run(pass.callable, RenderPassContext(*this, framebuffer));
+		if (profiler) {
+			profiler->endPass();
+		}
+	}
+}
+
+void RenderGraph::reset()
+{
+	releaseIdle(keepIdleFrames);
+	for (Physical& physical : physicals) {
+		physical.usedThisFrame = false;
+		physical.free = true;
+	}
+	passes.clear();
+	resources.clear();
+	order.clear();
+	compiled = false;
+}
+
+void RenderGraph::releaseIdle(int keepFrames)
+{
+	//textures no frame needed for a while (a resize, an effect turned off) go, along with their framebuffers
+	for (size_t i = physicals.size(); i-- > 0;) {
+		physicals[i].idleFrames = physicals[i].usedThisFrame ? 0 : physicals[i].idleFrames + 1;
+		if (physicals[i].idleFrames <= keepFrames) {
+			continue;
+		}
+		unsigned int texture = physicals[i].texture;
+		for (std::map<Attachments, unsigned int>::iterator it = framebuffers.begin(); it != framebuffers.end();) {
+			if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) {
+				glDeleteFramebuffers(1, &it->second);
+				it = framebuffers.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		glDeleteTextures(1, &texture);
+		physicals.erase(physicals.begin() + i);
+	}
+}
+
+void RenderGraph::destroy()
+{
+	reset();
+	releaseIdle(-1);
+}
+
+void RenderGraph::print(std::ostream& out) const
+{
+	out << "render graph:";
+	for (size_t i = 0; i < order.size(); i++) {
+		out << (i ? " -> " : " ") << passes[order[i]].name;
+	}
+	if (counts.culled > 0) {
+		out << " (culled:";
+		for (const Pass& pass : passes) {
+			if (pass.culled) {
+				out << " " << pass.name;
+			}
+		}
+		out << ")";
+	}
+	out << ", " << counts.transientTextures << " transient textures in " << counts.physicalTextures << ", "
+		<< counts.bytesWithoutAliasing / 1024 << " KiB without aliasing, " << counts.bytesWithAliasing / 1024 << " KiB with"
+		<< std::endl;
+}
@@ -0,0 +1,200 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include "arena.h"
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class GpuProfiler;
+class RenderGraph;
+
+//a texture or framebuffer of the frame being built, an index into the graph's resources
+typedef int RenderResource;
+
+struct RenderTextureDesc
+{
+	int width;
+	int height;
+	//GL_RGBA8, GL_RGBA16F, GL_DEPTH_COMPONENT24
+	GLenum format;
+};
+
+//what a pass says about itself while it's being added
+class RenderPassBuilder
+{
+public:
+	//a transient texture only this frame knows, written by this pass (the name has to outlive the frame)
+	RenderResource create(const char* name, const RenderTextureDesc& desc);
+	void read(RenderResource resource);
+	void write(RenderResource resource);
+	//the pass has to run even if nothing reads what it writes (readback, timing)
+	void sideEffect();
+
+private:
+	friend class RenderGraph;
+	RenderPassBuilder(RenderGraph& graph, int pass) : graph(graph), pass(pass) {}
+	RenderGraph& graph;
+	int pass;
+};
+
+//what a pass gets when it runs, its framebuffer is already bound with a viewport over all of it
+class RenderPassContext
+{
+public:
+	//the gl texture behind a transient resource (0 for imported ones)
+	unsigned int texture(RenderResource resource) const;
+	unsigned int framebuffer() const { return boundFramebuffer; }
+
+private:
+	friend class RenderGraph;
+	RenderPassContext(const RenderGraph& graph, unsigned int framebuffer) : graph(graph), boundFramebuffer(framebuffer) {}
+	const RenderGraph& graph;
+	unsigned int boundFramebuffer;
+};
+
+struct RenderGraphStats
+{
+	int passes = 0;
+	int culled = 0;
+	int transientTextures = 0;
+	//gl textures they ended up in
+	int physicalTextures = 0;
+	//peak transient memory, every texture on its own against textures sharing when their lifetimes don't overlap
+	uint64_t bytesWithoutAliasing = 0;
+	uint64_t bytesWithAliasing = 0;
+
+	bool operator==(const RenderGraphStats& other) const;
+	bool operator!=(const RenderGraphStats& other) const { return !(*this == other); }
+};
+
+//the frame as passes that declare what they read & write, rebuilt every frame:
+//compile() orders the passes by their dependencies, culls the ones nothing needed reads from, works out how long
+//each transient texture lives and hands them textures from a pool, where textures of the same size & format
+//that are never alive at the same time share one; execute() then runs them with their framebuffers bound
+//a transient resource has exactly one writer, imported ones (the window) are what the frame is for
+//everything about the frame's passes lives in the frame arena, so building & compiling a frame allocates nothing
+//once the pool & the framebuffers are there
+class RenderGraph
+{
+public:
+	//the arena has to be reset after the graph's reset(), never between addPass() & execute()
+	explicit RenderGraph(FrameArena& arena);
+	~RenderGraph();
+
+	//a framebuffer from outside (the window or the headless target), never allocated, writing it keeps a pass alive
+	RenderResource importFramebuffer(const char* name, unsigned int framebuffer, int width, int height);
+	//names are kept as pointers, they have to outlive the frame (literals, or strings that stay put)
+	//setup(RenderPassBuilder&) runs right away, execute(const RenderPassContext&) is copied into the arena & runs
+	//in execute(), so it can only capture what's trivially destructible (references, pointers, handles)
+	template <typename Setup, typename Execute>
+	void addPass(const char* name, Setup&& setup, Execute&& execute);
+
+	void compile();
+	void execute();
+	//forgets the frame's passes & resources, the textures stay in the pool for the next frames (the ones no frame
+	//used for a while are deleted)
+	void reset();
+	void destroy();
+
+	//false gives every transient texture its own memory, to compare against
+	void setAliasing(bool on) { aliasing = on; }
+	//times each pass that runs under its name
+	void setProfiler(GpuProfiler* gpuProfiler) { profiler = gpuProfiler; }
+
+	const RenderGraphStats& stats() const { return counts; }
+	//the passes in the order they run, the culled ones & the memory
+	void print(std::ostream& out) const;
+
+private:
+	friend class RenderPassBuilder;
+	friend class RenderPassContext;
+
+	typedef std::vector<RenderResource, ArenaAllocator<RenderResource>> ResourceList;
+	//color attachments then the depth attachment, the gl textures of a pass's framebuffer
+	static const int maxColorAttachments = 4;
+	typedef std::array<unsigned int, maxColorAttachments + 1> Attachments;
+
+	struct Resource
+	{
+		const char* name;
+		RenderTextureDesc desc;
+		bool imported = false;
+		unsigned int framebuffer = 0;
+		int writer = -1;
+		//positions in the execution order, -1 until compiled
+		int first = -1;
+		int last = -1;
+		int physical = -1;
+	};
+	struct Pass
+	{
+		explicit Pass(FrameArena& arena) : reads(arena), writes(arena) {}
+		const char* name = "";
+		//the execute callable in the arena & what calls it
+		void* callable = nullptr;
+		void (*run)(void* callable, const RenderPassContext& context) = nullptr;
+		ResourceList reads;
+		ResourceList writes;
+		bool sideEffect = false;
+		bool culled = false;
+	};
+	struct Physical
+	{
+		RenderTextureDesc desc;
+		unsigned int texture = 0;
+		bool usedThisFrame = false;
+		bool free = true;
+		//frames in a row nothing used it
+		int idleFrames = 0;
+	};
+
+	//how long an unused texture is kept: passes that only run now & then (a measurement, a capture) find theirs
+	//still there instead of making the texture & its framebuffer again, a resize frees the old ones soon enough
+	static const int keepIdleFrames = 240;
+
+	FrameArena& arena;
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<int> order;
+	std::vector<Physical> physicals;
+	//one per combination of attachments
+	std::map<Attachments, unsigned int> framebuffers;
+	bool aliasing = true;
+	bool compiled = false;
+	GpuProfiler* profiler = nullptr;
+	RenderGraphStats counts;
+
+	int acquire(const RenderTextureDesc& desc);
+	unsigned int framebufferFor(const Pass& pass, int& width, int& height);
+	//starts a pass, the builder & the caller fill in the rest
+	int beginPass(const char* name);
+	//deletes the textures idle for more than keepFrames frames, counting this one
+	void releaseIdle(int keepFrames);
+};
+
+template <typename Setup, typename Execute>
+void RenderGraph::addPass(const char* name, Setup&& setup, Execute&& execute)
+{
+	typedef typename std::decay<Execute>::type Callable;
+	//reset() only drops the memory, no destructor ever runs
+	static_assert(std::is_trivially_destructible<Callable>::value, "render pass callbacks can only capture trivially destructible things");
+	int index = beginPass(name);
+	Pass& pass = passes[index];
+	pass.callable = new (arena.allocate(sizeof(Callable), alignof(Callable))) Callable(std::forward<Execute>(execute));
+	pass.run = [](void* callable, const RenderPassContext& context) { (*static_cast<Callable*>(callable))(context); };
+	RenderPassBuilder builder(*this, index);
+	setup(builder);
+}
+
+//bytes a texture of that size & format takes
+uint64_t renderTextureBytes(const RenderTextureDesc& desc);
+
+#endif // !RENDERGRAPH_H
@@ -0,0 +1,70 @@
+#include "renderstats.h"
+
+RenderStats renderStats;
+
+static RenderStats lastFrame;
+static RenderStats total;
+static uint64_t frames = 0;
+
+RenderStats& RenderStats::operator+=(const RenderStats& other)
+{
+	drawCalls += other.drawCalls;
+	primitives += other.primitives;
+	programBinds += other.programBinds;
+	textureBinds += other.textureBinds;
+	uniformUploads += other.uniformUploads;
+	bufferBytes += other.bufferBytes;
+	stateChanges += other.stateChanges;
+	return *this;
+}
+
+void endRenderStatsFrame()
+{
+	lastFrame = renderStats;
+	total += renderStats;
+	frames++;
+	renderStats = RenderStats();
+}
+
+const RenderStats& lastFrameRenderStats()
+{
+	return lastFrame;
+}
+
+const RenderStats& totalRenderStats()
+{
+	return total;
+}
+
+uint64_t renderStatsFrames()
+{
+	return frames;
+}
+
+void resetRenderStats()
+{
+	renderStats = RenderStats();
+	lastFrame = RenderStats();
+	total = RenderStats();
+	frames = 0;
+}
+
+bool renderStatsCompiled()
+{
+#ifdef NO_RENDER_STATS
+	return false;
+#else
+	return true;
+#endif
+}
+
+void printRenderStats(std::ostream& out, const RenderStats& stats, uint64_t frames)
+{
+	if (frames == 0) {
+		frames = 1;
+	}
+	out << "stats: " << stats.drawCalls / frames << " draws, " << stats.primitives / frames << " primitives, "
+		<< stats.programBinds / frames << " program binds, " << stats.textureBinds / frames << " texture binds, "
+		<< stats.uniformUploads / frames << " uniforms, " << stats.bufferBytes / frames << " buffer bytes, "
+		<< stats.stateChanges / frames << " state changes" << std::endl;
+}
@@ -0,0 +1,170 @@
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <ostream>
+
+//how much work a frame handed to gl, counted by the thin wrappers below (and Shader's uniform setters)
+//build with -DNO_RENDER_STATS and the wrappers are plain gl calls again, the counters then just stay at zero
+struct RenderStats
+{
+	uint64_t drawCalls = 0;
+	uint64_t primitives = 0;
+	uint64_t programBinds = 0;
+	uint64_t textureBinds = 0;
+	uint64_t uniformUploads = 0;
+	//bytes handed to glBufferData & glBufferSubData
+	uint64_t bufferBytes = 0;
+	//polygon mode, enables, depth & blend state, masks, clear color, viewport, active texture unit, samplers
+	uint64_t stateChanges = 0;
+
+	RenderStats& operator+=(const RenderStats& other);
+};
+
+//what the current frame did so far (only the main thread talks to gl, so no atomics)
+extern RenderStats renderStats;
+
+#ifdef NO_RENDER_STATS
+#define RENDER_STAT(counter, amount) ((void)0)
+#else
+#define RENDER_STAT(counter, amount) (renderStats.counter += (amount))
+#endif
+
+//triangles/lines/points a draw of count vertices makes
+inline uint64_t primitivesDrawn(GLenum mode, GLsizei count)
+{
+	switch (mode) {
+	case GL_TRIANGLES:
+		return count / 3;
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN:
+		return count > 2 ? count - 2 : 0;
+	case GL_LINES:
+		return count / 2;
+	case GL_LINE_STRIP:
+		return count > 1 ? count - 1 : 0;
+	default:
+		return count;
+	}
+}
+
+inline void drawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	RENDER_STAT(drawCalls, 1);
+	RENDER_STAT(primitives, primitivesDrawn(mode, count));
+	glDrawArrays(mode, first, count);
+}
+
+inline void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+	RENDER_STAT(drawCalls, 1);
+	RENDER_STAT(primitives, primitivesDrawn(mode, count));
+	glDrawElements(mode, count, type, indices);
+}
+
+inline void useProgram(GLuint program)
+{
+	RENDER_STAT(programBinds, 1);
+	glUseProgram(program);
+}
+
+inline void bindTexture(GLenum target, GLuint texture)
+{
+	RENDER_STAT(textureBinds, 1);
+	glBindTexture(target, texture);
+}
+
+inline void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	RENDER_STAT(bufferBytes, (uint64_t)size);
+	glBufferData(target, size, data, usage);
+}
+
+inline void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	RENDER_STAT(bufferBytes, (uint64_t)size);
+	glBufferSubData(target, offset, size, data);
+}
+
+inline void polygonMode(GLenum face, GLenum mode)
+{
+	RENDER_STAT(stateChanges, 1);
+	glPolygonMode(face, mode);
+}
+
+inline void enableState(GLenum cap)
+{
+	RENDER_STAT(stateChanges, 1);
+	glEnable(cap);
+}
+
+inline void disableState(GLenum cap)
+{
+	RENDER_STAT(stateChanges, 1);
+	glDisable(cap);
+}
+
+inline void depthFunc(GLenum func)
+{
+	RENDER_STAT(stateChanges, 1);
+	glDepthFunc(func);
+}
+
+inline void depthMask(GLboolean write)
+{
+	RENDER_STAT(stateChanges, 1);
+	glDepthMask(write);
+}
+
+inline void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+	RENDER_STAT(stateChanges, 1);
+	glColorMask(red, green, blue, alpha);
+}
+
+inline void blendFunc(GLenum source, GLenum destination)
+{
+	RENDER_STAT(stateChanges, 1);
+	glBlendFunc(source, destination);
+}
+
+inline void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	RENDER_STAT(stateChanges, 1);
+	glClearColor(red, green, blue, alpha);
+}
+
+inline void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	RENDER_STAT(stateChanges, 1);
+	glViewport(x, y, width, height);
+}
+
+inline void activeTexture(GLenum unit)
+{
+	RENDER_STAT(stateChanges, 1);
+	glActiveTexture(unit);
+}
+
+inline void bindSampler(GLuint unit, GLuint sampler)
+{
+	RENDER_STAT(stateChanges, 1);
+	glBindSampler(unit, sampler);
+}
+
+//closes the frame: renderStats becomes the last frame's numbers, gets added to the totals and starts over
+void endRenderStatsFrame();
+const RenderStats& lastFrameRenderStats();
+const RenderStats& totalRenderStats();
+uint64_t renderStatsFrames();
+//forgets everything counted so far (e.g. the setup before the first frame)
+void resetRenderStats();
+//false when built with NO_RENDER_STATS
+bool renderStatsCompiled();
+
+//one summary line, stats divided by frames (so totals print as per frame averages)
+void printRenderStats(std::ostream& out, const RenderStats& stats, uint64_t frames = 1);
+
+#endif // !RENDERSTATS_H
@@ -0,0 +1,122 @@
+#include "sampler.h"
+#include "renderstats.h"
+
+#include <iostream>
+
+const SamplerDesc samplerPresets[] = {
+	//mipmapped textures on the cubes
+	{"trilinear_repeat", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT},
+	{"trilinear_mirror", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_MIRRORED_REPEAT, GL_MIRRORED_REPEAT},
+	{"trilinear_clamp", GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE},
+	//render targets and full screen passes, no mips
+	{"linear_clamp", GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE},
+	{"nearest_clamp", GL_NEAREST, GL_NEAREST, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE},
+	//what main.cpp used to end up with: base level only, the invalid mag filter left it at GL_LINEAR
+	{"legacy_nearest", GL_NEAREST, GL_LINEAR, GL_MIRRORED_REPEAT, GL_MIRRORED_REPEAT},
+};
+const int samplerPresetCount = sizeof(samplerPresets) / sizeof(samplerPresets[0]);
+
+static bool isMinFilter(GLenum filter)
+{
+	switch (filter) {
+	case GL_NEAREST:
+	case GL_LINEAR:
+	case GL_NEAREST_MIPMAP_NEAREST:
+	case GL_LINEAR_MIPMAP_NEAREST:
+	case GL_NEAREST_MIPMAP_LINEAR:
+	case GL_LINEAR_MIPMAP_LINEAR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool isWrap(GLenum wrap)
+{
+	switch (wrap) {
+	case GL_REPEAT:
+	case GL_MIRRORED_REPEAT:
+	case GL_CLAMP_TO_EDGE:
+	case GL_CLAMP_TO_BORDER:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool validateSamplerDesc(const SamplerDesc& desc)
+{
+	bool valid = true;
+	if (!isMinFilter(desc.minFilter)) {
+		std::cout << "ERROR::SAMPLER::" << desc.name << "::INVALID_MIN_FILTER " << desc.minFilter << std::endl;
+		valid = false;
+	}
+	//magnification never uses mipmaps, only GL_NEAREST and GL_LINEAR are allowed
+	if (desc.magFilter != GL_NEAREST && desc.magFilter != GL_LINEAR) {
+		std::cout << "ERROR::SAMPLER::" << desc.name << "::INVALID_MAG_FILTER " << desc.magFilter << std::endl;
+		valid = false;
+	}
+	if (!isWrap(desc.wrapS) || !isWrap(desc.wrapT)) {
+		std::cout << "ERROR::SAMPLER::" << desc.name << "::INVALID_WRAP" << std::endl;
+		valid = false;
+	}
+	return valid;
+}
+
+bool SamplerLibrary::create()
+{
+	destroy();
+	bool success = true;
+	//flush anything older so the check below only sees errors from the sampler calls
+	while (glGetError() != GL_NO_ERROR) {
+	}
+	for (int i = 0; i < samplerPresetCount; i++) {
+		const SamplerDesc& desc = samplerPresets[i];
+		if (!validateSamplerDesc(desc)) {
+			success = false;
+			continue;
+		}
+		unsigned int id;
+		glGenSamplers(1, &id);
+		glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, desc.minFilter);
+		glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, desc.magFilter);
+		glSamplerParameteri(id, GL_TEXTURE_WRAP_S, desc.wrapS);
+		glSamplerParameteri(id, GL_TEXTURE_WRAP_T, desc.wrapT);
+		//the driver gets the last word, read the state back to make sure it took
+		int minFilter, magFilter;
+		glGetSamplerParameteriv(id, GL_TEXTURE_MIN_FILTER, &minFilter);
+		glGetSamplerParameteriv(id, GL_TEXTURE_MAG_FILTER, &magFilter);
+		if (glGetError() != GL_NO_ERROR || (GLenum)minFilter != desc.minFilter || (GLenum)magFilter != desc.magFilter) {
+			std::cout << "ERROR::SAMPLER::" << desc.name << "::REJECTED_BY_DRIVER" << std::endl;
+			glDeleteSamplers(1, &id);
+			success = false;
+			continue;
+		}
+		samplers.push_back({desc.name, id});
+	}
+	return success;
+}
+
+void SamplerLibrary::destroy()
+{
+	for (Sampler& sampler : samplers) {
+		glDeleteSamplers(1, &sampler.id);
+	}
+	samplers.clear();
+}
+
+unsigned int SamplerLibrary::get(const std::string& name) const
+{
+	for (const Sampler& sampler : samplers) {
+		if (sampler.name == name) {
+			return sampler.id;
+		}
+	}
+	std::cout << "ERROR::SAMPLER::UNKNOWN_PRESET " << name << std::endl;
+	return 0;
+}
+
+void SamplerLibrary::bind(unsigned int unit, const std::string& name) const
+{
+	bindSampler(unit, get(name));
+}
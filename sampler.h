@@ -0,0 +1,48 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+//how a texture gets filtered and wrapped, textures only hold the pixels and samplers are bound per unit
+struct SamplerDesc
+{
+	const char* name;
+	GLenum minFilter;
+	GLenum magFilter;
+	GLenum wrapS;
+	GLenum wrapT;
+};
+
+//the fixed set of samplers the renderer uses, each one checked and created once
+//there are no setters, a preset never changes after creation
+class SamplerLibrary
+{
+public:
+	//validates and creates every preset in samplerPresets, returns false if any was rejected
+	bool create();
+	void destroy();
+
+	//0 (the texture's own state) if there is no preset with that name
+	unsigned int get(const std::string& name) const;
+	void bind(unsigned int unit, const std::string& name) const;
+
+private:
+	struct Sampler
+	{
+		std::string name;
+		unsigned int id;
+	};
+	std::vector<Sampler> samplers;
+};
+
+//the presets SamplerLibrary::create makes
+extern const SamplerDesc samplerPresets[];
+extern const int samplerPresetCount;
+
+//checks a description against what gl accepts for each parameter, prints why it is invalid
+bool validateSamplerDesc(const SamplerDesc& desc);
+
+#endif // !SAMPLER_H
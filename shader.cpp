@@ -1,4 +1,6 @@
 #include "shader.h"
+#include "cpuprofile.h"
+#include "renderstats.h"
 
 #include <glad/glad.h>
 
@@ -48,6 +50,7 @@ static void printGlError(){
 //constructer to build & read the shader
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
 {
+	CPU_ZONE("Shader::Shader");
 	//retrives the vertex/fragment source code from filepath
 	std::string vertexCode;
 	std::string fragmentCode;
@@ -76,9 +79,19 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 	}
 
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
+	compile(vertexCode.c_str(), fragmentCode.c_str());
+}
+
+Shader Shader::fromSource(const std::string& vertexCode, const std::string& fragmentCode)
+{
+	Shader shader;
+	shader.compile(vertexCode.c_str(), fragmentCode.c_str());
+	return shader;
+}
 
+void Shader::compile(const char* vShaderCode, const char* fShaderCode)
+{
+	CPU_ZONE("Shader::compile");
 	//compile shaders
 
 	unsigned int vertex, fragment;
@@ -155,57 +168,119 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 //use/activate the shader
 void Shader::use()
 {
-	glUseProgram(ID);
+	useProgram(ID);
 }
 
 // utility uniform functions
+//the c string versions do the work
+void Shader::setBool(const char* name, bool value) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform1i(glGetUniformLocation(ID, name), (int)value);
+}
+void Shader::setInt(const char* name, int value) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform1i(glGetUniformLocation(ID, name), value);
+}
+void Shader::setFloat(const char* name, float value) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform1f(glGetUniformLocation(ID, name), value);
+}
+void Shader::setVec2(const char* name, const glm::vec2& value) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
+}
+void Shader::setVec2(const char* name, float x, float y) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform2f(glGetUniformLocation(ID, name), x, y);
+}
+void Shader::setVec3(const char* name, const glm::vec3& value) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
+}
+void Shader::setVec3(const char* name, float x, float y, float z) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform3f(glGetUniformLocation(ID, name), x, y, z);
+}
+void Shader::setVec4(const char* name, const glm::vec4& value) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform4fv(glGetUniformLocation(ID, name), 1, &value[0]);
+}
+void Shader::setVec4(const char* name, float x, float y, float z, float w) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
+}
+void Shader::setMat2(const char* name, const glm::mat2& mat) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setMat3(const char* name, const glm::mat3& mat) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setMat4(const char* name, const glm::mat4& mat) const
+{
+	RENDER_STAT(uniformUploads, 1);
+	glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+}
+//std::string names (built at runtime) go through the c string ones
 void Shader::setBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	setBool(name.c_str(), value);
 }
 void Shader::setInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	setInt(name.c_str(), value);
 }
 void Shader::setFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	setFloat(name.c_str(), value);
 }
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-	glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	setVec2(name.c_str(), value);
 }
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+	setVec2(name.c_str(), x, y);
 }
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	setVec3(name.c_str(), value);
 }
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+	setVec3(name.c_str(), x, y, z);
 }
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-	glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	setVec4(name.c_str(), value);
 }
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 {
-	glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+	setVec4(name.c_str(), x, y, z, w);
 }
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	setMat2(name.c_str(), mat);
 }
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	setMat3(name.c_str(), mat);
 }
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	setMat4(name.c_str(), mat);
 }
 
 bool Shader::getBool(const std::string& name) 
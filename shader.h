@@ -14,10 +14,26 @@ public:
 
 	//constructer to build & read the shader
 	Shader(const char* vertexPath, const char* fragmentPath);
+	//builds from the code itself, for shaders generated at runtime
+	static Shader fromSource(const std::string& vertexCode, const std::string& fragmentCode);
 	//use/activate the shader
 	void use();
 
 	// utility uniform functions
+	//c string names for the literals in per frame code, a std::string of one can mean a heap allocation
+	void setBool(const char* name, bool value) const;
+	void setInt(const char* name, int value) const;
+	void setFloat(const char* name, float value) const;
+	void setVec2(const char* name, const glm::vec2& value) const;
+	void setVec2(const char* name, float x, float y) const;
+	void setVec3(const char* name, const glm::vec3& value) const;
+	void setVec3(const char* name, float x, float y, float z) const;
+	void setVec4(const char* name, const glm::vec4& value) const;
+	void setVec4(const char* name, float x, float y, float z, float w) const;
+	void setMat2(const char* name, const glm::mat2& mat) const;
+	void setMat3(const char* name, const glm::mat3& mat) const;
+	void setMat4(const char* name, const glm::mat4& mat) const;
+	//names built at runtime
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
 	void setFloat(const std::string& name, float value) const;
@@ -40,6 +56,10 @@ public:
 	glm::mat2 getMat2(const std::string& name);
 	glm::mat3 getMat3(const std::string& name);
 	glm::mat4 getMat4(const std::string& name);
+
+private:
+	Shader() = default;
+	void compile(const char* vShaderCode, const char* fShaderCode);
 };
 
 #endif // !SHADER_H
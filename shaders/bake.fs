@@ -0,0 +1,12 @@
+#version 130
+
+varying vec2 TexCoord;
+
+uniform sampler2D texture1;
+uniform sampler2D texture2;
+uniform float blendWeight;
+
+void main()
+{
+    gl_FragColor = mix(texture2D(texture1, TexCoord), texture2D(texture2, TexCoord), blendWeight);
+}
@@ -0,0 +1,11 @@
+#version 130
+
+varying vec2 TexCoord;
+
+void main()
+{
+    //one triangle that covers the whole target, no vertex buffer needed
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoord = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
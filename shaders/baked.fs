@@ -0,0 +1,11 @@
+#version 130
+
+varying vec2 TexCoord;
+
+//texture1 & texture2 already mixed together at load time
+uniform sampler2D baked;
+
+void main()
+{
+    gl_FragColor = texture2D(baked, TexCoord);
+}
@@ -0,0 +1,7 @@
+#version 130
+
+void main()
+{
+    //with additive blending every fragment that passes the depth test counts one (of 255) in red
+    gl_FragColor = vec4(1.0 / 255.0, 0.0, 0.0, 0.0);
+}
@@ -0,0 +1,26 @@
+#version 130
+
+varying vec2 TexCoord;
+
+//fragments shaded per pixel, in steps of 1/255 in red
+uniform sampler2D counts;
+
+void main()
+{
+    float shaded = floor(texelFetch(counts, ivec2(gl_FragCoord.xy), 0).r * 255.0 + 0.5);
+    //nothing black, shaded once blue, then green, yellow & red for 4 or more
+    vec3 heat = vec3(0.0);
+    if (shaded >= 4.0) {
+        heat = vec3(1.0, 0.0, 0.0);
+    }
+    else if (shaded >= 3.0) {
+        heat = vec3(1.0, 1.0, 0.0);
+    }
+    else if (shaded >= 2.0) {
+        heat = vec3(0.0, 0.8, 0.0);
+    }
+    else if (shaded >= 1.0) {
+        heat = vec3(0.0, 0.2, 0.8);
+    }
+    gl_FragColor = vec4(heat, 1.0);
+}
@@ -0,0 +1,13 @@
+//contrast around mid grey, saturation against luma & a warm/cool tint
+uniform float grade_contrast;
+uniform float grade_saturation;
+uniform float grade_temperature;
+
+vec4 grade(vec4 color, vec2 uv)
+{
+    vec3 graded = (color.rgb - 0.5) * grade_contrast + 0.5;
+    float luma = dot(graded, vec3(0.2126, 0.7152, 0.0722));
+    graded = mix(vec3(luma), graded, grade_saturation);
+    graded *= vec3(1.0 + grade_temperature, 1.0, 1.0 - grade_temperature);
+    return vec4(clamp(graded, 0.0, 1.0), color.a);
+}
@@ -0,0 +1,10 @@
+//unsharp mask over the 4 direct neighbours, reads around the pixel so it can only start a pass
+uniform float sharpen_amount;
+
+vec4 sharpen(vec2 uv)
+{
+    vec4 centre = texture2D(source, uv);
+    vec4 around = texture2D(source, uv + vec2(texel.x, 0.0)) + texture2D(source, uv - vec2(texel.x, 0.0))
+        + texture2D(source, uv + vec2(0.0, texel.y)) + texture2D(source, uv - vec2(0.0, texel.y));
+    return vec4(max(centre.rgb + (centre.rgb - around.rgb * 0.25) * sharpen_amount, 0.0), centre.a);
+}
@@ -0,0 +1,9 @@
+//exposure then the aces filmic curve (narkowicz's fit)
+uniform float tonemap_exposure;
+
+vec4 tonemap(vec4 color, vec2 uv)
+{
+    vec3 x = color.rgb * tonemap_exposure;
+    vec3 mapped = (x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14);
+    return vec4(clamp(mapped, 0.0, 1.0), color.a);
+}
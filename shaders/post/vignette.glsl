@@ -0,0 +1,10 @@
+//darkens towards the corners
+uniform float vignette_strength;
+uniform float vignette_radius;
+
+vec4 vignette(vec4 color, vec2 uv)
+{
+    float distance = length(uv - 0.5) * 1.41421356;
+    float falloff = smoothstep(vignette_radius, 1.0, distance);
+    return vec4(color.rgb * (1.0 - falloff * vignette_strength), color.a);
+}
@@ -5,8 +5,9 @@ varying vec2 TexCoord;
 
 uniform sampler2D texture1;
 uniform sampler2D texture2;
+uniform float blendWeight;
 
 void main()
 {
-    gl_FragColor = mix(texture2D(texture1, TexCoord), texture2D(texture2, TexCoord), 0.2).abgr;
+    gl_FragColor = mix(texture2D(texture1, TexCoord), texture2D(texture2, TexCoord), blendWeight);
 }
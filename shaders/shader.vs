@@ -8,6 +8,9 @@ uniform mat4 view;
 uniform mat4 model;
 uniform mat4 projection;
 
+//the depth prepass draws with the same shader and has to land on exactly the same depth
+invariant gl_Position;
+
 void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
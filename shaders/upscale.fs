@@ -0,0 +1,15 @@
+#version 130
+
+varying vec2 TexCoord;
+
+//the scene, rendered into the lower left corner of a target the size of the window
+uniform sampler2D scene;
+//the rendered corner's size & its last texel centre, in texture coordinates
+uniform vec2 uvScale;
+uniform vec2 uvMax;
+
+void main()
+{
+    //clamped so the bilinear filter never reads past the rendered corner into last frame's leftovers
+    gl_FragColor = texture2D(scene, min(TexCoord * uvScale, uvMax));
+}
@@ -0,0 +1,36 @@
+#include "simclock.h"
+
+#include <cmath>
+
+SimulationClock::SimulationClock(double step, int maxSteps) : stepSeconds(step), maxSteps(maxSteps)
+{
+}
+
+void SimulationClock::setRate(double stepsPerSecond)
+{
+	if (stepsPerSecond > 0.0) {
+		stepSeconds = 1.0 / stepsPerSecond;
+		accumulator = 0.0;
+	}
+}
+
+int SimulationClock::advance(double frameSeconds)
+{
+	//a clock going backwards (or a recorded one from another run) never un-runs steps
+	if (frameSeconds > 0.0) {
+		accumulator += frameSeconds;
+	}
+	int due = 0;
+	while (accumulator >= stepSeconds && due < maxSteps) {
+		accumulator -= stepSeconds;
+		due++;
+	}
+	//whole steps still left after maxSteps are given up, the fraction stays for interpolation
+	if (accumulator >= stepSeconds) {
+		double behind = std::floor(accumulator / stepSeconds) * stepSeconds;
+		droppedSeconds += behind;
+		accumulator -= behind;
+	}
+	steps += due;
+	return due;
+}
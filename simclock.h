@@ -0,0 +1,39 @@
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+#include <cstdint>
+
+//runs the simulation in fixed steps whatever the frame rate, so camera movement & animation behave (and cost)
+//the same at 30 or 300 fps and replay exactly from the same frame times
+//frames add their real duration to an accumulator (a double, so hours long sessions keep their precision) and
+//then run as many whole steps as fit, what's left over becomes alpha, how far the frame is between the last two
+//steps, which rendering interpolates the state by
+class SimulationClock
+{
+public:
+	//maxSteps: steps run per frame at most, a long stall drops the rest instead of spiralling into ever
+	//longer frames
+	explicit SimulationClock(double step = 1.0 / 120.0, int maxSteps = 8);
+
+	void setRate(double stepsPerSecond);
+	//adds the frame's duration, returns how many steps to run now
+	int advance(double frameSeconds);
+
+	double step() const { return stepSeconds; }
+	//simulated seconds after the steps advance() asked for
+	double time() const { return steps * stepSeconds; }
+	//0..1 between the state before the last step and after it
+	double alpha() const { return accumulator / stepSeconds; }
+	uint64_t stepCount() const { return steps; }
+	//simulated time given up to stalls
+	double dropped() const { return droppedSeconds; }
+
+private:
+	double stepSeconds;
+	int maxSteps;
+	double accumulator = 0.0;
+	uint64_t steps = 0;
+	double droppedSeconds = 0.0;
+};
+
+#endif // !SIMCLOCK_H
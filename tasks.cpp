@@ -0,0 +1,201 @@
+#include "tasks.h"
+#include "cpuprofile.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+//the workers know they're workers, so hopping onto one from one doesn't go through the queue
+static thread_local bool onWorkerThread = false;
+
+//what spawn() wraps a task in: starts at once and frees its own frame when done
+struct SpawnedTask
+{
+	struct promise_type
+	{
+		SpawnedTask get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+static double ticksToMs(uint64_t ticks)
+{
+	return (double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+TaskScheduler::TaskScheduler(int workerCount) : glThread(std::this_thread::get_id())
+{
+	if (workerCount <= 0) {
+		workerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	}
+	for (int i = 0; i < workerCount; i++) {
+		workers.push_back(std::thread(&TaskScheduler::work, this));
+	}
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workerWake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+bool TaskScheduler::Hop::await_ready() const noexcept
+{
+	return toWorker ? onWorkerThread : std::this_thread::get_id() == scheduler->glThread;
+}
+
+void TaskScheduler::Hop::await_suspend(std::coroutine_handle<> handle) const
+{
+	scheduler->schedule(handle, toWorker);
+}
+
+void TaskScheduler::schedule(std::coroutine_handle<> handle, bool toWorker)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		(toWorker ? workerQueue : glQueue).push_back(handle);
+	}
+	if (toWorker) {
+		workerWake.notify_one();
+	}
+	else {
+		glWake.notify_one();
+	}
+}
+
+SpawnedTask TaskScheduler::runSpawned(Task<void> task, TaskScheduler* scheduler)
+{
+	co_await std::move(task);
+	{
+		std::lock_guard<std::mutex> lock(scheduler->mutex);
+		scheduler->running--;
+	}
+	scheduler->glWake.notify_one();
+}
+
+void TaskScheduler::spawn(Task<void> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (started == 0) {
+			started = cpuProfileNow();
+		}
+		running++;
+	}
+	runSpawned(std::move(task), this);
+}
+
+void TaskScheduler::run()
+{
+	while (true) {
+		std::coroutine_handle<> next;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (glQueue.empty() && running > 0) {
+				CPU_ZONE("wait for workers");
+				uint64_t waitStart = cpuProfileNow();
+				glWake.wait(lock, [this] { return !glQueue.empty() || running == 0; });
+				idle += ticksToMs(cpuProfileNow() - waitStart);
+			}
+			if (glQueue.empty()) {
+				break;
+			}
+			//oldest first, so a task that's been waiting for the gl thread longest gets on with it
+			next = glQueue.front();
+			glQueue.erase(glQueue.begin());
+		}
+		next.resume();
+	}
+	ended = cpuProfileNow();
+}
+
+void TaskScheduler::work()
+{
+	setCpuProfileThreadName("task worker");
+	onWorkerThread = true;
+	while (true) {
+		std::coroutine_handle<> next;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workerWake.wait(lock, [this] { return stopping || !workerQueue.empty(); });
+			if (workerQueue.empty()) {
+				return;
+			}
+			next = workerQueue.front();
+			workerQueue.erase(workerQueue.begin());
+		}
+		next.resume();
+	}
+}
+
+void TaskScheduler::recordStage(const char* name, double ms)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bool worker = onWorkerThread;
+	auto stage = std::find_if(stageStats.begin(), stageStats.end(), [&](const TaskStageStats& stats) {
+		return stats.name == name && stats.onWorker == worker;
+	});
+	if (stage == stageStats.end()) {
+		stageStats.push_back({name, worker, 0, 0.0});
+		stage = stageStats.end() - 1;
+	}
+	stage->count++;
+	stage->ms += ms;
+}
+
+void TaskScheduler::printStages(std::ostream& out) const
+{
+	double busy = 0.0;
+	for (const TaskStageStats& stage : stageStats) {
+		busy += stage.ms;
+	}
+	out << "startup tasks: " << ticksToMs(ended - started) << " ms, " << busy << " ms of stages, gl thread waited "
+		<< idle << " ms for the workers" << std::endl;
+	for (const TaskStageStats& stage : stageStats) {
+		out << "  " << stage.name << (stage.onWorker ? " (worker)" : " (gl thread)") << ": " << stage.count << " x, "
+			<< stage.ms << " ms" << std::endl;
+	}
+}
+
+TaskStage::TaskStage(TaskScheduler& scheduler, const char* name) : scheduler(scheduler), name(name), start(cpuProfileBegin())
+{
+}
+
+TaskStage::~TaskStage()
+{
+	uint64_t end = cpuProfileNow();
+	if (cpuProfiling()) {
+		cpuProfileRecord(name, start, end);
+	}
+	scheduler.recordStage(name, ticksToMs(end - start));
+}
+
+Task<std::string> readFile(TaskScheduler& scheduler, std::string path)
+{
+	co_await scheduler.onWorker();
+	TaskStage stage(scheduler, "read file");
+	std::string contents;
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) {
+		std::cout << "ERROR::TASKS::FILE_NOT_READ " << path << std::endl;
+		co_return contents;
+	}
+	char buffer[16 * 1024];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		contents.append(buffer, read);
+	}
+	fclose(file);
+	co_return contents;
+}
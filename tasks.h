@@ -0,0 +1,209 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class Task;
+struct SpawnedTask;
+
+//where a task goes once it's done: back into whoever co_awaited it, on the same thread
+struct TaskPromiseBase
+{
+	std::coroutine_handle<> continuation;
+
+	struct FinalAwaiter
+	{
+		bool await_ready() noexcept { return false; }
+		template <typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			std::coroutine_handle<> next = handle.promise().continuation;
+			return next ? next : std::noop_coroutine();
+		}
+		void await_resume() noexcept {}
+	};
+
+	//tasks are lazy, nothing runs until they're awaited (or spawned)
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	FinalAwaiter final_suspend() noexcept { return {}; }
+	//nothing in here throws on purpose, an exception is a bug
+	void unhandled_exception() { std::terminate(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase
+{
+	std::optional<T> value;
+
+	Task<T> get_return_object();
+	template <typename U>
+	void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+	T take() { return std::move(*value); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase
+{
+	Task<void> get_return_object();
+	void return_void() {}
+	void take() {}
+};
+
+//a coroutine giving back a T: co_await it from another task (it starts then and the awaiting one carries on
+//with its result when it finishes), or hand a Task<void> to TaskScheduler::spawn
+//which thread it runs on is up to the co_await scheduler.onWorker()/onGLThread() hops inside it
+template <typename T = void>
+class Task
+{
+public:
+	typedef TaskPromise<T> promise_type;
+
+	explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+	Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	Task& operator=(Task&& other) noexcept
+	{
+		if (this != &other) {
+			destroy();
+			handle = std::exchange(other.handle, nullptr);
+		}
+		return *this;
+	}
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+	~Task() { destroy(); }
+
+	auto operator co_await() && noexcept
+	{
+		struct Awaiter
+		{
+			std::coroutine_handle<promise_type> handle;
+
+			bool await_ready() noexcept { return handle.done(); }
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+			{
+				handle.promise().continuation = awaiting;
+				return handle;
+			}
+			T await_resume() { return handle.promise().take(); }
+		};
+		return Awaiter{handle};
+	}
+
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	void destroy()
+	{
+		if (handle) {
+			handle.destroy();
+			handle = nullptr;
+		}
+	}
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+	return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+	return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+//how long one kind of step took over all the tasks that ran it
+struct TaskStageStats
+{
+	const char* name;
+	bool onWorker;
+	int count;
+	double ms;
+};
+
+//runs tasks across a few worker threads (file reads, decoding, anything without gl) and the gl thread, the one
+//that made the scheduler and calls run(), a task moves between them with co_await onWorker() / onGLThread()
+//so independent tasks overlap: one's upload runs while another is still decoding
+class TaskScheduler
+{
+public:
+	//workers: 0 is one per core but the gl thread's, at least one
+	explicit TaskScheduler(int workers = 0);
+	~TaskScheduler();
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+	//co_await one of these and the rest of the task runs on that kind of thread (right away if it's there already)
+	struct Hop
+	{
+		TaskScheduler* scheduler;
+		bool toWorker;
+
+		bool await_ready() const noexcept;
+		void await_suspend(std::coroutine_handle<> handle) const;
+		void await_resume() const noexcept {}
+	};
+	Hop onWorker() { return Hop{this, true}; }
+	Hop onGLThread() { return Hop{this, false}; }
+
+	//starts the task on the calling thread, it goes on from its first hop, run() returns once it's done
+	void spawn(Task<void> task);
+	//on the gl thread: runs its share of the tasks until every spawned one has finished
+	void run();
+	//per stage times from TaskStage, for the startup numbers
+	void recordStage(const char* name, double ms);
+	//the stages, and the time they took together against the time from the first spawn to the end of run()
+	void printStages(std::ostream& out) const;
+
+private:
+	std::vector<std::thread> workers;
+	std::thread::id glThread;
+	std::mutex mutex;
+	std::condition_variable workerWake;
+	std::condition_variable glWake;
+	std::vector<std::coroutine_handle<>> workerQueue;
+	std::vector<std::coroutine_handle<>> glQueue;
+	int running = 0;
+	bool stopping = false;
+	double idle = 0.0;
+	uint64_t started = 0;
+	uint64_t ended = 0;
+	std::vector<TaskStageStats> stageStats;
+
+	void schedule(std::coroutine_handle<> handle, bool toWorker);
+	void work();
+	//awaits a spawned task and tells run() when it's done, the frame goes away by itself
+	static SpawnedTask runSpawned(Task<void> task, TaskScheduler* scheduler);
+};
+
+//times a step of a task for the scheduler's numbers and the cpu trace, it mustn't span a co_await
+//(the task could carry on on another thread)
+class TaskStage
+{
+public:
+	TaskStage(TaskScheduler& scheduler, const char* name);
+	~TaskStage();
+	TaskStage(const TaskStage&) = delete;
+	TaskStage& operator=(const TaskStage&) = delete;
+
+private:
+	TaskScheduler& scheduler;
+	const char* name;
+	uint64_t start;
+};
+
+//the whole file on a worker thread, empty if it can't be read
+Task<std::string> readFile(TaskScheduler& scheduler, std::string path);
+
+#endif // !TASKS_H
@@ -0,0 +1,408 @@
+#include "texman.h"
+#include "hash.h"
+#include "loader.h"
+#include "mipmap.h"
+#include "renderstats.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+
+//levels are only dropped while the top level stays at least this big, smaller textures get evicted outright
+static const int minDroppedSize = 64;
+
+TextureManager::TextureManager(size_t budgetBytes) : budget(budgetBytes)
+{
+	//slot 0 is never handed out so a zeroed handle is always invalid
+	entries.resize(1);
+	frameStats.budgetBytes = budget;
+}
+
+TextureManager::Entry* TextureManager::lookup(TextureHandle handle)
+{
+	if (handle.index == 0 || handle.index >= entries.size() || entries[handle.index].generation != handle.generation) {
+		return nullptr;
+	}
+	return &entries[handle.index];
+}
+
+const TextureManager::Entry* TextureManager::lookup(TextureHandle handle) const
+{
+	return const_cast<TextureManager*>(this)->lookup(handle);
+}
+
+size_t TextureManager::residentSize(const Entry& entry, int droppedLevels) const
+{
+	if (entry.texture == 0) {
+		return 0;
+	}
+	size_t size = 0;
+	int width = entry.width, height = entry.height;
+	for (int i = 0; i < entry.levels; i++) {
+		if (i >= droppedLevels) {
+			size += (size_t)width * height * 4;
+		}
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return size;
+}
+
+//(re)creates the gl texture with the levels from droppedLevels down, storage is immutable so it is always a new texture
+bool TextureManager::upload(Entry& entry, int droppedLevels)
+{
+	MipChain chain;
+	if (!loadMipmappedChain(entry.path.c_str(), chain)) {
+		std::cout << "Failed to load texture " << entry.path << std::endl;
+		return false;
+	}
+	upload(entry, chain, droppedLevels);
+	return true;
+}
+
+void TextureManager::upload(Entry& entry, const MipChain& chain, int droppedLevels)
+{
+	//the upload goes through whatever unit is active, which may hold another texture the frame still draws with
+	//(a unit that held the old version of this one gets the new one)
+	int previous;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+	bool replacesPrevious = entry.texture != 0 && (unsigned int)previous == entry.texture;
+	unload(entry);
+	entry.width = chain.levels[0].width;
+	entry.height = chain.levels[0].height;
+	entry.levels = chain.levels.size();
+	entry.droppedLevels = std::clamp(droppedLevels, 0, entry.levels - 1);
+	glGenTextures(1, &entry.texture);
+	glBindTexture(GL_TEXTURE_2D, entry.texture);
+	uploadMipChain(chain, entry.droppedLevels);
+	glBindTexture(GL_TEXTURE_2D, replacesPrevious ? entry.texture : previous);
+	frameStats.residentBytes += residentSize(entry, entry.droppedLevels);
+	frameStats.resident++;
+}
+
+bool TextureManager::request(Entry& entry, int droppedLevels)
+{
+	if (!loader) {
+		return upload(entry, droppedLevels);
+	}
+	if (entry.ticket) {
+		if (entry.ticketLevels == droppedLevels) {
+			return true;
+		}
+		cancel(entry);
+	}
+	entry.ticket = loader->loadTexture(entry.path, droppedLevels);
+	entry.ticketLevels = droppedLevels;
+	pendingSavings += dropSavings(entry);
+	return true;
+}
+
+void TextureManager::cancel(Entry& entry)
+{
+	if (entry.ticket) {
+		pendingSavings -= dropSavings(entry);
+		loader->discard(entry.ticket);
+		entry.ticket = 0;
+	}
+}
+
+size_t TextureManager::dropSavings(const Entry& entry) const
+{
+	if (!entry.ticket || entry.ticketLevels <= entry.droppedLevels) {
+		return 0;
+	}
+	return residentSize(entry, entry.droppedLevels) - residentSize(entry, entry.ticketLevels);
+}
+
+void TextureManager::rehash(uint32_t index, uint64_t hash)
+{
+	Entry& entry = entries[index];
+	if (hash == 0 || hash == entry.hash) {
+		return;
+	}
+	auto previous = byHash.find(entry.hash);
+	if (previous != byHash.end() && previous->second == index) {
+		byHash.erase(previous);
+	}
+	entry.hash = hash;
+	byHash.emplace(hash, index);
+}
+
+void TextureManager::collect()
+{
+	if (!loader) {
+		return;
+	}
+	int streaming = 0;
+	for (uint32_t i = 1; i < entries.size(); i++) {
+		Entry& entry = entries[i];
+		if (!entry.ticket) {
+			continue;
+		}
+		LoadedResource result;
+		if (!loader->take(entry.ticket, result)) {
+			streaming++;
+			continue;
+		}
+		pendingSavings -= dropSavings(entry);
+		entry.ticket = 0;
+		//a failed load keeps whatever was there
+		if (!result.object) {
+			continue;
+		}
+		unload(entry);
+		rehash(i, result.hash);
+		entry.texture = result.object;
+		entry.width = result.width;
+		entry.height = result.height;
+		entry.levels = result.levels;
+		entry.droppedLevels = result.firstLevel;
+		frameStats.residentBytes += residentSize(entry, entry.droppedLevels);
+		frameStats.resident++;
+		frameStats.streamed++;
+	}
+	frameStats.streaming = streaming;
+}
+
+void TextureManager::unload(Entry& entry)
+{
+	if (entry.texture) {
+		frameStats.residentBytes -= residentSize(entry, entry.droppedLevels);
+		glDeleteTextures(1, &entry.texture);
+		entry.texture = 0;
+		frameStats.resident--;
+	}
+}
+
+TextureHandle TextureManager::load(const std::string& path)
+{
+	uint64_t hash = hashFile(path.c_str());
+	if (hash == 0) {
+		std::cout << "Failed to read texture " << path << std::endl;
+		return TextureHandle();
+	}
+	return add(path, hash, nullptr);
+}
+
+TextureHandle TextureManager::load(const std::string& path, uint64_t hash, const MipChain& chain)
+{
+	return add(path, hash, &chain);
+}
+
+TextureHandle TextureManager::add(const std::string& path, uint64_t hash, const MipChain* chain)
+{
+	//the same pixels under another name share one texture
+	auto existing = byHash.find(hash);
+	if (existing != byHash.end()) {
+		Entry& entry = entries[existing->second];
+		entry.references++;
+		frameStats.dedupHits++;
+		return {existing->second, entry.generation};
+	}
+
+	uint32_t index;
+	if (!freeSlots.empty()) {
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else {
+		index = entries.size();
+		entries.emplace_back();
+	}
+	Entry& entry = entries[index];
+	uint32_t generation = entry.generation + 1;
+	entry = Entry();
+	entry.generation = generation;
+	entry.path = path;
+	entry.hash = hash;
+	entry.references = 1;
+	entry.lastUsed = frame;
+	if (chain) {
+		upload(entry, *chain, 0);
+	}
+	else if (!upload(entry, 0)) {
+		entry.references = 0;
+		freeSlots.push_back(index);
+		return TextureHandle();
+	}
+	byHash[hash] = index;
+	frameStats.loads++;
+	frameStats.textures++;
+	enforceBudget();
+	return {index, generation};
+}
+
+void TextureManager::retain(TextureHandle handle)
+{
+	if (Entry* entry = lookup(handle)) {
+		entry->references++;
+	}
+}
+
+void TextureManager::release(TextureHandle handle)
+{
+	Entry* entry = lookup(handle);
+	if (!entry || --entry->references > 0) {
+		return;
+	}
+	cancel(*entry);
+	unload(*entry);
+	//after a reload the hash may belong to another entry, its mapping stays
+	auto mapping = byHash.find(entry->hash);
+	if (mapping != byHash.end() && mapping->second == handle.index) {
+		byHash.erase(mapping);
+	}
+	//bumping the generation makes every copy of the handle stale
+	entry->generation++;
+	entry->path.clear();
+	freeSlots.push_back(handle.index);
+	frameStats.textures--;
+}
+
+unsigned int TextureManager::bind(unsigned int unit, TextureHandle handle)
+{
+	Entry* entry = lookup(handle);
+	if (!entry) {
+		return 0;
+	}
+	entry->lastUsed = frame;
+	activeTexture(GL_TEXTURE0 + unit);
+	//streams the full chain back in, the budget is settled at the end of the frame
+	//(a loader's one isn't there yet, this binds what there is until it is)
+	if ((entry->texture == 0 || entry->droppedLevels > 0) && !(entry->ticket && entry->ticketLevels == 0)) {
+		if (request(*entry, 0)) {
+			frameStats.reloads++;
+		}
+	}
+	bindTexture(GL_TEXTURE_2D, entry->texture);
+	return entry->texture;
+}
+
+void TextureManager::setLoader(ResourceLoader* newLoader)
+{
+	for (uint32_t i = 1; i < entries.size(); i++) {
+		cancel(entries[i]);
+	}
+	loader = newLoader;
+}
+
+void TextureManager::reload(TextureHandle handle)
+{
+	Entry* entry = lookup(handle);
+	if (!entry) {
+		return;
+	}
+	//a job already going may have read the old file
+	cancel(*entry);
+	//an evicted one reads the new file whenever it's bound next
+	if (entry->texture == 0) {
+		return;
+	}
+	if (loader) {
+		request(*entry, entry->droppedLevels);
+	}
+	else if (upload(*entry, entry->droppedLevels)) {
+		rehash(handle.index, hashFile(entry->path.c_str()));
+	}
+	frameStats.reloads++;
+}
+
+unsigned int TextureManager::texture(TextureHandle handle) const
+{
+	const Entry* entry = lookup(handle);
+	return entry ? entry->texture : 0;
+}
+
+void TextureManager::beginFrame()
+{
+	frame++;
+	frameStats.evictions = 0;
+	frameStats.mipDrops = 0;
+	frameStats.reloads = 0;
+	frameStats.loads = 0;
+	frameStats.dedupHits = 0;
+	frameStats.streamed = 0;
+	collect();
+}
+
+void TextureManager::endFrame()
+{
+	enforceBudget();
+}
+
+void TextureManager::setBudget(size_t bytes)
+{
+	budget = bytes;
+	frameStats.budgetBytes = bytes;
+	enforceBudget();
+}
+
+void TextureManager::enforceBudget()
+{
+	//mip drops the loader hasn't finished count as done, or every frame until then would drop more
+	auto resident = [this] { return frameStats.residentBytes - pendingSavings; };
+	if (resident() <= budget) {
+		return;
+	}
+	//least recently used first, anything bound this frame (or still being loaded) is off limits
+	std::vector<uint32_t> candidates;
+	for (uint32_t i = 1; i < entries.size(); i++) {
+		if (entries[i].texture && entries[i].references > 0 && entries[i].lastUsed < frame && !entries[i].ticket) {
+			candidates.push_back(i);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+		return entries[a].lastUsed < entries[b].lastUsed;
+	});
+	for (uint32_t index : candidates) {
+		if (resident() <= budget) {
+			break;
+		}
+		Entry& entry = entries[index];
+		//work out how many top levels have to go, stopping before the top level gets too small
+		size_t current = residentSize(entry, entry.droppedLevels);
+		int dropped = entry.droppedLevels;
+		while (dropped + 1 < entry.levels
+			&& std::max(entry.width >> (dropped + 1), entry.height >> (dropped + 1)) >= minDroppedSize
+			&& resident() - (current - residentSize(entry, dropped)) > budget) {
+			dropped++;
+		}
+		if (resident() - (current - residentSize(entry, dropped)) <= budget && dropped > entry.droppedLevels) {
+			if (request(entry, dropped)) {
+				frameStats.mipDrops++;
+			}
+		}
+		else {
+			unload(entry);
+			frameStats.evictions++;
+		}
+	}
+}
+
+void TextureManager::printStats() const
+{
+	std::cout << "textures: " << frameStats.resident << "/" << frameStats.textures << " resident, "
+		<< frameStats.residentBytes / 1024 << "/" << frameStats.budgetBytes / 1024 << " KiB, "
+		<< frameStats.loads << " loads, " << frameStats.dedupHits << " shared, "
+		<< frameStats.reloads << " reloads, " << frameStats.mipDrops << " mip drops, "
+		<< frameStats.evictions << " evictions";
+	if (loader) {
+		std::cout << ", " << frameStats.streamed << " streamed in, " << frameStats.streaming << " on the way";
+	}
+	std::cout << std::endl;
+}
+
+void TextureManager::destroy()
+{
+	for (uint32_t i = 1; i < entries.size(); i++) {
+		cancel(entries[i]);
+		unload(entries[i]);
+	}
+	entries.resize(1);
+	freeSlots.clear();
+	byHash.clear();
+	frameStats = TextureStats();
+	frameStats.budgetBytes = budget;
+	pendingSavings = 0;
+}
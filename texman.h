@@ -0,0 +1,128 @@
+#ifndef TEXMAN_H
+#define TEXMAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ResourceLoader;
+struct MipChain;
+
+//refers to a texture owned by TextureManager, stays valid while the gl texture behind it gets
+//evicted, shrunk or reloaded, and goes stale (not reused) once the last reference is released
+struct TextureHandle
+{
+	uint32_t index = 0;
+	uint32_t generation = 0;
+
+	bool valid() const { return generation != 0; }
+};
+
+//per frame numbers, the counters reset in beginFrame
+struct TextureStats
+{
+	size_t residentBytes = 0;
+	size_t budgetBytes = 0;
+	int textures = 0;
+	int resident = 0;
+	int evictions = 0;
+	int mipDrops = 0;
+	int reloads = 0;
+	//loader thread uploads swapped in, and how many are still on their way
+	int streamed = 0;
+	int streaming = 0;
+	int loads = 0;
+	int dedupHits = 0;
+};
+
+//owns every asset texture: loads are deduplicated by content hash and reference counted, and when the
+//resident mip chains go over the budget the least recently bound ones first lose their top levels,
+//then get evicted entirely, to be streamed back in the next time something binds them
+//with a loader the reloads & shrunk chains are made on its thread, the texture that's there stays in use
+//(an evicted one binds as 0) until the new one is ready
+class TextureManager
+{
+public:
+	explicit TextureManager(size_t budgetBytes = 256 * 1024 * 1024);
+
+	//loads (or shares) the texture for an asset, starts with one reference
+	TextureHandle load(const std::string& path);
+	//the same with the chain (and the file's hash) read somewhere else, e.g. on a worker thread, only the upload is left
+	TextureHandle load(const std::string& path, uint64_t hash, const MipChain& chain);
+	void retain(TextureHandle handle);
+	//deletes the texture when the last reference goes
+	void release(TextureHandle handle);
+
+	//where reloads & mip drops get made from now on, null makes them right away on the render thread again
+	void setLoader(ResourceLoader* loader);
+	//reads the asset again (it changed on disk), through the loader if there is one
+	void reload(TextureHandle handle);
+
+	//binds the texture to a unit and marks it used this frame, reloads it first if it was evicted or shrunk
+	//returns the gl texture (0 for a stale handle)
+	unsigned int bind(unsigned int unit, TextureHandle handle);
+	//the current gl texture without touching residency, 0 if evicted
+	unsigned int texture(TextureHandle handle) const;
+
+	//swaps in what the loader finished (after its update())
+	void beginFrame();
+	//enforces the budget against everything not bound this frame
+	void endFrame();
+
+	void setBudget(size_t bytes);
+	const TextureStats& stats() const { return frameStats; }
+	void printStats() const;
+
+	//releases everything regardless of references
+	void destroy();
+
+private:
+	struct Entry
+	{
+		std::string path;
+		uint64_t hash = 0;
+		uint32_t generation = 0;
+		int references = 0;
+		unsigned int texture = 0;
+		//how many of the biggest levels are currently left out
+		int droppedLevels = 0;
+		int levels = 0;
+		int width = 0;
+		int height = 0;
+		uint64_t lastUsed = 0;
+		//the loader's job making this texture's next version, with the levels it leaves out
+		uint32_t ticket = 0;
+		int ticketLevels = 0;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<uint32_t> freeSlots;
+	std::unordered_map<uint64_t, uint32_t> byHash;
+	size_t budget;
+	uint64_t frame = 1;
+	TextureStats frameStats;
+	ResourceLoader* loader = nullptr;
+	//what the mip drops the loader is still making will free, the budget counts it as gone already
+	size_t pendingSavings = 0;
+
+	Entry* lookup(TextureHandle handle);
+	const Entry* lookup(TextureHandle handle) const;
+	//a new entry (or a reference to the one with the same hash), the chain is read from the file if it's null
+	TextureHandle add(const std::string& path, uint64_t hash, const MipChain* chain);
+	bool upload(Entry& entry, int droppedLevels);
+	void upload(Entry& entry, const MipChain& chain, int droppedLevels);
+	//upload, on the loader's thread when there is one, false if it failed right away
+	bool request(Entry& entry, int droppedLevels);
+	void cancel(Entry& entry);
+	void collect();
+	//what the entry's job frees once it's swapped in, if it's a mip drop
+	size_t dropSavings(const Entry& entry) const;
+	void rehash(uint32_t index, uint64_t hash);
+	void unload(Entry& entry);
+	size_t residentSize(const Entry& entry, int droppedLevels) const;
+	void enforceBudget();
+};
+
+#endif // !TEXMAN_H
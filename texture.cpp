@@ -0,0 +1,74 @@
+#include "texture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TexStorage2DProc texStorage2D = NULL;
+
+static bool hasExtension(const char* name)
+{
+	int count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (int i = 0; i < count; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void initTextureStorage(GLADloadproc load)
+{
+	texStorage2D = NULL;
+	if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2) || hasExtension("GL_ARB_texture_storage")) {
+		texStorage2D = (TexStorage2DProc)load("glTexStorage2D");
+	}
+	if (!texStorage2D) {
+		std::cout << "glTexStorage2D not available, textures use mutable storage" << std::endl;
+	}
+}
+
+bool hasTextureStorage()
+{
+	return texStorage2D != NULL;
+}
+
+//the unsized format and type glTexImage2D needs for the fallback path
+static void unsizedFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+{
+	switch (internalFormat) {
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32F:
+		format = GL_DEPTH_COMPONENT;
+		type = GL_FLOAT;
+		break;
+	case GL_RGBA16F:
+	case GL_RGBA32F:
+		format = GL_RGBA;
+		type = GL_FLOAT;
+		break;
+	default:
+		format = GL_RGBA;
+		type = GL_UNSIGNED_BYTE;
+		break;
+	}
+}
+
+void allocateTextureStorage(GLenum internalFormat, int levels, int width, int height)
+{
+	if (texStorage2D) {
+		texStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+		return;
+	}
+	GLenum format, type;
+	unsizedFormat(internalFormat, format, type);
+	for (int i = 0; i < levels; i++) {
+		glTexImage2D(GL_TEXTURE_2D, i, internalFormat, width, height, 0, format, type, NULL);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
@@ -0,0 +1,21 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <glad/glad.h>
+
+//glTexStorage2D is core in 4.2 (ARB_texture_storage before that), the glad loader only goes up to 3.3
+//so it is looked up by hand after the context exists
+void initTextureStorage(GLADloadproc load);
+//whether the driver gave us real immutable storage
+bool hasTextureStorage();
+
+typedef void (APIENTRYP TexStorage2DProc)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+//what initTextureStorage found, NULL without immutable storage (glcapture wraps it like the glad entry points)
+extern TexStorage2DProc texStorage2D;
+
+//allocates every level of the bound GL_TEXTURE_2D at once, immutable when the driver supports it,
+//otherwise each level is defined up front and the level range is pinned so the texture is always mip complete
+//the pixels then go in with glTexSubImage2D
+void allocateTextureStorage(GLenum internalFormat, int levels, int width, int height);
+
+#endif // !TEXTURE_H